@@ -0,0 +1,286 @@
+#include "../src/domain/GridPathfindingWithTarPit.h"
+#include "../src/node.h"
+#include "../src/utility/BucketQueue.h"
+#include "../src/utility/DiscreteDistribution.h"
+#include "../src/utility/StateMap.h"
+#include "../src/utility/NormalDistribution.h"
+#include "../src/utility/PriorityQueue.h"
+#include "../src/utility/RadixHeap.h"
+#include "instances.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+typedef GridPathfindingWithTarPit                                   Domain;
+typedef SearchNode<Domain>                                          Node;
+typedef StateMap<Domain::State, shared_ptr<Node>, Domain::HashState> Closed;
+
+namespace {
+
+// nodes on distinct grid cells with random g and h, the same seed gives
+// the same nodes; whole-numbered g and h for `integral`
+vector<shared_ptr<Node>> makeNodes(size_t n, uint64_t seed,
+                                   bool integral = false)
+{
+    RandomGenerator rng(seed);
+
+    vector<shared_ptr<Node>> nodes;
+    nodes.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        Domain::State s(i % 1024, i / 1024, Domain::Action{0, 0});
+        double g = rng.random() * 100;
+        double h = rng.random() * 100;
+        double d = rng.random() * 100;
+        if (integral) {
+            g = floor(g);
+            h = floor(h);
+        }
+        nodes.push_back(make_shared<Node>(g, h, d, 1, 0, 0, s, nullptr));
+    }
+    return nodes;
+}
+
+} // namespace
+
+static void BM_PriorityQueuePushPop(benchmark::State& state)
+{
+    auto nodes = makeNodes(static_cast<size_t>(state.range(0)), 1);
+
+    for (auto _ : state) {
+        PriorityQueue<shared_ptr<Node>> open(Node::compareNodesF);
+        for (const auto& n : nodes) {
+            open.push(n);
+        }
+        while (!open.empty()) {
+            benchmark::DoNotOptimize(open.top());
+            open.pop();
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PriorityQueuePushPop)->Range(64, 1 << 14);
+
+// decrease-key on a full heap, the way duplicate detection reopens nodes
+static void BM_PriorityQueueUpdate(benchmark::State& state)
+{
+    auto nodes = makeNodes(static_cast<size_t>(state.range(0)), 2);
+
+    PriorityQueue<shared_ptr<Node>> open(Node::compareNodesF);
+    for (const auto& n : nodes) {
+        open.push(n);
+    }
+
+    RandomGenerator rng(3);
+    for (auto _ : state) {
+        auto& n = nodes[rng.below(nodes.size())];
+        n->setGValue(n->getGValue() * 0.9);
+        open.update(n);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PriorityQueueUpdate)->Range(64, 1 << 14);
+
+// a beam of range(0) nodes fed four times as many, most pushes evicting
+static void BM_PriorityQueueBeamPush(benchmark::State& state)
+{
+    size_t width = static_cast<size_t>(state.range(0));
+    auto   nodes = makeNodes(4 * width, 6);
+
+    for (auto _ : state) {
+        PriorityQueue<shared_ptr<Node>> open(static_cast<double>(width),
+                                             Node::compareNodesF);
+        for (const auto& n : nodes) {
+            benchmark::DoNotOptimize(open.push(n));
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * 4 * state.range(0));
+}
+BENCHMARK(BM_PriorityQueueBeamPush)->Range(64, 1 << 12);
+
+// the same nodes as BM_BucketQueuePushPop, for comparison
+static void BM_PriorityQueuePushPopIntegral(benchmark::State& state)
+{
+    auto nodes = makeNodes(static_cast<size_t>(state.range(0)), 1, true);
+
+    for (auto _ : state) {
+        PriorityQueue<shared_ptr<Node>> open(Node::compareNodesF);
+        for (const auto& n : nodes) {
+            open.push(n);
+        }
+        while (!open.empty()) {
+            benchmark::DoNotOptimize(open.top());
+            open.pop();
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PriorityQueuePushPopIntegral)->Range(64, 1 << 14);
+
+static void BM_BucketQueuePushPop(benchmark::State& state)
+{
+    auto nodes = makeNodes(static_cast<size_t>(state.range(0)), 1, true);
+
+    for (auto _ : state) {
+        BucketQueue<Node> open;
+        for (const auto& n : nodes) {
+            open.push(n);
+        }
+        while (!open.empty()) {
+            benchmark::DoNotOptimize(open.top());
+            open.pop();
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BucketQueuePushPop)->Range(64, 1 << 14);
+
+static void BM_BucketQueueUpdate(benchmark::State& state)
+{
+    auto nodes = makeNodes(static_cast<size_t>(state.range(0)), 2, true);
+
+    BucketQueue<Node> open;
+    for (const auto& n : nodes) {
+        open.push(n);
+    }
+
+    RandomGenerator rng(3);
+    for (auto _ : state) {
+        auto& n = nodes[rng.below(nodes.size())];
+        if (n->getGValue() >= 1) {
+            n->setGValue(n->getGValue() - 1);
+        }
+        open.update(n);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BucketQueueUpdate)->Range(64, 1 << 14);
+
+// the backward Dijkstra passes order their frontier this way
+static void BM_RadixHeapPushPop(benchmark::State& state)
+{
+    auto nodes = makeNodes(static_cast<size_t>(state.range(0)), 1);
+
+    RadixHeap<shared_ptr<Node>> frontier;
+    for (auto _ : state) {
+        for (const auto& n : nodes) {
+            frontier.push(n->getFValue(), n);
+        }
+        while (!frontier.empty()) {
+            benchmark::DoNotOptimize(frontier.top());
+            frontier.pop();
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_RadixHeapPushPop)->Range(64, 1 << 14);
+
+// the closed list is filled anew every lookahead
+static void BM_ClosedInsert(benchmark::State& state)
+{
+    auto nodes = makeNodes(static_cast<size_t>(state.range(0)), 4);
+
+    Closed closed;
+    for (auto _ : state) {
+        closed.clear();
+        for (const auto& n : nodes) {
+            closed[n->getState()] = n;
+        }
+        benchmark::DoNotOptimize(closed.size());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ClosedInsert)->Range(64, 1 << 14);
+
+static void BM_ClosedFind(benchmark::State& state)
+{
+    auto nodes = makeNodes(static_cast<size_t>(state.range(0)), 5);
+
+    Closed closed;
+    for (const auto& n : nodes) {
+        closed[n->getState()] = n;
+    }
+
+    size_t i = 0;
+    for (auto _ : state) {
+        auto it = closed.find(nodes[i]->getState());
+        benchmark::DoNotOptimize(it);
+        i = i + 1 == nodes.size() ? 0 : i + 1;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ClosedFind)->Range(64, 1 << 14);
+
+// the nancy backup combines beliefs of sibling frontiers this way
+static void BM_DiscreteDistributionProduct(benchmark::State& state)
+{
+    auto samples = static_cast<size_t>(state.range(0));
+
+    DiscreteDistribution d1(samples, 40, 9);
+    DiscreteDistribution d2(samples, 42, 16);
+
+    for (auto _ : state) {
+        auto d = d1 * d2;
+        benchmark::DoNotOptimize(d.getDistSize());
+    }
+}
+BENCHMARK(BM_DiscreteDistributionProduct)->RangeMultiplier(2)->Range(8, 128);
+
+static void BM_DiscreteDistributionFromNormal(benchmark::State& state)
+{
+    auto samples = static_cast<size_t>(state.range(0));
+
+    for (auto _ : state) {
+        DiscreteDistribution d(samples, 40, 9);
+        benchmark::DoNotOptimize(d.getDistSize());
+    }
+}
+BENCHMARK(BM_DiscreteDistributionFromNormal)
+  ->RangeMultiplier(2)
+  ->Range(8, 128);
+
+static void BM_NormalProbLowerCost(benchmark::State& state)
+{
+    RandomGenerator rng(6);
+
+    vector<NormalDistribution> ds;
+    for (size_t i = 0; i < 1024; ++i) {
+        double mean = 1 + rng.random() * 49;
+        double var  = 1 + rng.random() * 49;
+        ds.push_back(NormalDistribution(mean, var));
+    }
+
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+          computeProbOfd1IsLowerCost(ds[i], ds[(i + 1) & 1023]));
+        i = (i + 1) & 1023;
+    }
+}
+BENCHMARK(BM_NormalProbLowerCost);
+
+static void BM_NormalCDF(benchmark::State& state)
+{
+    double x = -3;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(standardNormalCDF(x));
+        benchmark::DoNotOptimize(standardNormalPDF(x));
+        benchmark::DoNotOptimize(normalPDF(x, 1, 2));
+        x = x > 3 ? -3 : x + 0.01;
+    }
+}
+BENCHMARK(BM_NormalCDF);
@@ -0,0 +1,208 @@
+#include "../src/domain/GridPathfinding.h"
+#include "../src/domain/GridPathfindingWithTarPit.h"
+#include "../src/domain/PancakePuzzle.h"
+#include "../src/domain/RaceTrack.h"
+#include "../src/domain/SlidingTilePuzzle.h"
+#include "instances.h"
+
+#include <benchmark/benchmark.h>
+
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// states reached by a seeded random walk from the start, so successors and
+// heuristic are measured on a realistic mix instead of the start alone
+template<class Domain>
+vector<typename Domain::State> sampleStates(Domain& domain, size_t n)
+{
+    RandomGenerator rng(7);
+
+    vector<typename Domain::State> states;
+    auto                           cur = domain.getStartState();
+    while (states.size() < n) {
+        states.push_back(cur);
+        auto succs = domain.successors(cur);
+        cur = succs.empty() ? domain.getStartState()
+                            : succs[rng.below(succs.size())];
+    }
+    return states;
+}
+
+template<class Domain>
+void successorsBench(benchmark::State& state, Domain& domain)
+{
+    auto states = sampleStates(domain, 1024);
+
+    size_t i = 0;
+    for (auto _ : state) {
+        auto succs = domain.successors(states[i]);
+        benchmark::DoNotOptimize(succs.data());
+        i = (i + 1) & 1023;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+template<class Domain>
+void heuristicBench(benchmark::State& state, Domain& domain)
+{
+    auto states = sampleStates(domain, 1024);
+
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(domain.heuristic(states[i]));
+        benchmark::DoNotOptimize(domain.distance(states[i]));
+        i = (i + 1) & 1023;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+// the first partial expansion of each state (see PartialExpansionAStar),
+// the children whose f is the state's own, against successorsBench
+template<class Domain>
+void operatorTableBench(benchmark::State& state, Domain& domain)
+{
+    typedef typename Domain::Cost Cost;
+
+    auto states = sampleStates(domain, 1024);
+
+    size_t i = 0;
+    for (auto _ : state) {
+        Cost next;
+        auto succs =
+          domain.successors(states[i], numeric_limits<Cost>::lowest(),
+                            domain.heuristic(states[i]), next);
+        benchmark::DoNotOptimize(succs.data());
+        benchmark::DoNotOptimize(next);
+        i = (i + 1) & 1023;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+// the heuristic, distance and distance error of all the successors of a
+// state, one state at a time or in one call to the domain's evaluate()
+template<class Domain>
+void evaluateBench(benchmark::State& state, Domain& domain, bool batch)
+{
+    typedef typename Domain::State State;
+    typedef typename Domain::Cost  Cost;
+
+    vector<vector<State>> children;
+    for (const State& s : sampleStates(domain, 1024)) {
+        children.push_back(domain.successors(s));
+    }
+
+    vector<Cost> h, d, derr;
+    size_t       i = 0;
+    for (auto _ : state) {
+        const vector<State>& succs = children[i];
+        if (batch) {
+            domain.evaluate(succs, h, d, derr);
+        } else {
+            h.resize(succs.size());
+            d.resize(succs.size());
+            derr.resize(succs.size());
+            for (size_t j = 0; j < succs.size(); ++j) {
+                h[j]    = domain.heuristic(succs[j]);
+                d[j]    = domain.distance(succs[j]);
+                derr[j] = domain.distanceErr(succs[j]);
+            }
+        }
+        benchmark::DoNotOptimize(h.data());
+        benchmark::DoNotOptimize(d.data());
+        benchmark::DoNotOptimize(derr.data());
+        i = (i + 1) & 1023;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+GridPathfinding& grid()
+{
+    static stringstream    in(gridInstance(256, 256, 0.2, 1, 11));
+    static GridPathfinding d(in);
+    return d;
+}
+
+GridPathfindingWithTarPit& tarPitGrid()
+{
+    static stringstream              in(gridInstance(256, 256, 0.2, 5, 12));
+    static GridPathfindingWithTarPit d(in);
+    return d;
+}
+
+RaceTrack& raceTrack()
+{
+    static stringstream map(raceTrackMap(128, 64, 0.1, 13));
+    static RaceTrack    d(map);
+    return d;
+}
+
+SlidingTilePuzzle& tile()
+{
+    static stringstream      in(tileInstance(4, 200, 14));
+    static SlidingTilePuzzle d(in);
+    return d;
+}
+
+PancakePuzzle& pancake()
+{
+    static stringstream in(pancakeInstance(50, 15));
+    static PancakePuzzle d(in);
+    return d;
+}
+
+} // namespace
+
+#define DOMAIN_BENCHMARKS(name, domain)                                        \
+    static void BM_Successors_##name(benchmark::State& state)                  \
+    {                                                                          \
+        successorsBench(state, domain());                                      \
+    }                                                                          \
+    BENCHMARK(BM_Successors_##name);                                           \
+    static void BM_Heuristic_##name(benchmark::State& state)                   \
+    {                                                                          \
+        heuristicBench(state, domain());                                       \
+    }                                                                          \
+    BENCHMARK(BM_Heuristic_##name)
+
+DOMAIN_BENCHMARKS(GridPathfinding, grid);
+DOMAIN_BENCHMARKS(GridPathfindingWithTarPit, tarPitGrid);
+DOMAIN_BENCHMARKS(RaceTrack, raceTrack);
+DOMAIN_BENCHMARKS(SlidingTilePuzzle, tile);
+DOMAIN_BENCHMARKS(PancakePuzzle, pancake);
+
+static void BM_OperatorTable_SlidingTilePuzzle(benchmark::State& state)
+{
+    operatorTableBench(state, tile());
+}
+BENCHMARK(BM_OperatorTable_SlidingTilePuzzle);
+
+static void BM_OperatorTable_PancakePuzzle(benchmark::State& state)
+{
+    operatorTableBench(state, pancake());
+}
+BENCHMARK(BM_OperatorTable_PancakePuzzle);
+
+#define EVALUATE_BENCHMARKS(name, domain)                                      \
+    static void BM_Evaluate_##name(benchmark::State& state)                    \
+    {                                                                          \
+        evaluateBench(state, domain(), false);                                 \
+    }                                                                          \
+    BENCHMARK(BM_Evaluate_##name);                                             \
+    static void BM_EvaluateBatch_##name(benchmark::State& state)               \
+    {                                                                          \
+        evaluateBench(state, domain(), true);                                  \
+    }                                                                          \
+    BENCHMARK(BM_EvaluateBatch_##name)
+
+EVALUATE_BENCHMARKS(GridPathfinding, grid);
+EVALUATE_BENCHMARKS(GridPathfindingWithTarPit, tarPitGrid);
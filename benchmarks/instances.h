@@ -0,0 +1,186 @@
+#pragma once
+#include "../src/utility/Random.h"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Deterministic instances in the text formats the domains parse, so
+// benchmarks don't depend on the instance repository.
+
+// `obstacles` of the cells are blocked and the same share are tar pits, start
+// in the top left corner, goal in the bottom right corner.
+inline string gridInstance(size_t width, size_t height, double obstacles,
+                           double tarPitCost, uint64_t seed)
+{
+    RandomGenerator rng(seed);
+
+    stringstream ss;
+    ss << width << "\n" << height << "\n";
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            double r = rng.random();
+            if (x == 0 && y == 0) {
+                ss << '@';
+            } else if (x == width - 1 && y == height - 1) {
+                ss << '*';
+            } else if (r < obstacles) {
+                ss << '#';
+            } else if (r < 2 * obstacles) {
+                ss << '$';
+            } else {
+                ss << '_';
+            }
+        }
+        ss << "\n";
+    }
+    // solution line, then the tar pit cost
+    ss << "0\n" << tarPitCost << "\n";
+    return ss.str();
+}
+
+// Racetrack map with a wall around it, blocked cells scattered inside and the
+// finish line along the right wall. The start is the '@' cell at (1, 1).
+inline string raceTrackMap(size_t width, size_t height, double obstacles,
+                           uint64_t seed)
+{
+    RandomGenerator rng(seed);
+
+    stringstream ss;
+    ss << width << "\n" << height << "\n";
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x) {
+            bool wall = x == 0 || y == 0 || x == width - 1 || y == height - 1;
+            if (x == width - 2 && !wall) {
+                ss << '*';
+            } else if (x == 1 && y == 1) {
+                ss << '@';
+            } else if (wall || (x > 2 && rng.random() < obstacles)) {
+                ss << '#';
+            } else {
+                ss << '_';
+            }
+        }
+        ss << "\n";
+    }
+    return ss.str();
+}
+
+// Sliding tile puzzle `walk` random blank moves away from the ordered goal.
+inline string tileInstance(size_t size, size_t walk, uint64_t seed)
+{
+    RandomGenerator rng(seed);
+
+    vector<int> goal(size * size);
+    for (size_t i = 0; i < goal.size(); ++i) {
+        goal[i] = static_cast<int>(i);
+    }
+
+    vector<int> start = goal;
+    size_t      blank = 0;
+    for (size_t i = 0; i < walk; ++i) {
+        vector<size_t> moves;
+        if (blank >= size) {
+            moves.push_back(blank - size);
+        }
+        if (blank + size < start.size()) {
+            moves.push_back(blank + size);
+        }
+        if (blank % size > 0) {
+            moves.push_back(blank - 1);
+        }
+        if (blank % size < size - 1) {
+            moves.push_back(blank + 1);
+        }
+        size_t next = moves[rng.below(moves.size())];
+        swap(start[blank], start[next]);
+        blank = next;
+    }
+
+    stringstream ss;
+    ss << size << " " << size << "\nstarting positions for each tile:\n";
+    for (int t : start) {
+        ss << t << "\n";
+    }
+    ss << "goal positions:\n";
+    for (int t : goal) {
+        ss << t << "\n";
+    }
+    return ss.str();
+}
+
+// Korf-style sliding tile puzzle: a uniformly random solvable permutation.
+inline string korfTileInstance(size_t size, uint64_t seed)
+{
+    RandomGenerator rng(seed);
+
+    vector<int> start(size * size);
+    for (size_t i = 0; i < start.size(); ++i) {
+        start[i] = static_cast<int>(i);
+    }
+
+    while (true) {
+        rng.shuffle(start.begin(), start.end());
+
+        size_t inversions = 0;
+        size_t blankRow   = 0;
+        for (size_t i = 0; i < start.size(); ++i) {
+            if (start[i] == 0) {
+                blankRow = i / size;
+                continue;
+            }
+            for (size_t j = i + 1; j < start.size(); ++j) {
+                if (start[j] != 0 && start[j] < start[i]) {
+                    ++inversions;
+                }
+            }
+        }
+
+        // the goal has the blank in the top left corner
+        bool solvable = size % 2 == 1 ? inversions % 2 == 0
+                                      : (inversions + blankRow) % 2 == 0;
+        if (solvable) {
+            break;
+        }
+    }
+
+    stringstream ss;
+    ss << size << " " << size << "\nstarting positions for each tile:\n";
+    for (int t : start) {
+        ss << t << "\n";
+    }
+    ss << "goal positions:\n";
+    for (size_t i = 0; i < start.size(); ++i) {
+        ss << i << "\n";
+    }
+    return ss.str();
+}
+
+// Random pancake stack, sorted goal.
+inline string pancakeInstance(size_t size, uint64_t seed)
+{
+    RandomGenerator rng(seed);
+
+    vector<unsigned int> goal(size);
+    for (size_t i = 0; i < size; ++i) {
+        goal[i] = static_cast<unsigned int>(i + 1);
+    }
+
+    vector<unsigned int> start = goal;
+    rng.shuffle(start.begin(), start.end());
+
+    stringstream ss;
+    ss << size << "\nstarting positions for each pancake:\n";
+    for (auto p : start) {
+        ss << p << "\n";
+    }
+    ss << "end positions:\n";
+    for (auto p : goal) {
+        ss << p << "\n";
+    }
+    return ss.str();
+}
@@ -0,0 +1,321 @@
+#include "../src/SearchRegistry.h"
+#include "../src/domain/GridPathfinding.h"
+#include "../src/domain/GridPathfindingWithTarPit.h"
+#include "../src/domain/PancakePuzzle.h"
+#include "../src/domain/RaceTrack.h"
+#include "../src/domain/SlidingTilePuzzle.h"
+#include "instances.h"
+
+#include <cxxopts.hpp>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+// End-to-end sweep: every expansion x decision x lookahead combination on
+// generated instances of every domain. Each run is forked so its peak RSS
+// can be read back with wait4() and a runaway run only costs its timeout.
+
+struct Instance
+{
+    string domain;
+    string name;
+    string text;
+};
+
+// what a forked run reports back through the pipe
+struct RunResult
+{
+    bool     solutionFound;
+    double   solutionCost;
+    double   solutionLength;
+    uint64_t nodesExpanded;
+    uint64_t nodesGenerated;
+    double   seconds;
+    uint64_t steps;
+    double   stepP50;
+    double   stepP90;
+    double   stepP99;
+    double   stepMax;
+};
+
+vector<string> split(const string& s)
+{
+    vector<string> ret;
+    stringstream   ss(s);
+    string         item;
+    while (getline(ss, item, ',')) {
+        if (!item.empty()) {
+            ret.push_back(item);
+        }
+    }
+    return ret;
+}
+
+// nearest rank percentile of sorted values
+double percentile(const vector<double>& sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    auto rank = static_cast<size_t>(p * static_cast<double>(sorted.size()));
+    return sorted[min(rank, sorted.size() - 1)];
+}
+
+vector<Instance> generateInstances(const vector<string>& domains, size_t count,
+                                   uint64_t seed)
+{
+    vector<Instance> instances;
+    for (const auto& domain : domains) {
+        for (size_t i = 0; i < count; ++i) {
+            auto   s    = seed + i;
+            string name = domain + "-" + to_string(s);
+
+            if (domain == "gridPathfinding") {
+                instances.push_back(
+                  {domain, name, gridInstance(100, 100, 0.2, 1, s)});
+            } else if (domain == "gridPathfindingWithTarPit") {
+                instances.push_back(
+                  {domain, name, gridInstance(100, 100, 0.2, 5, s)});
+            } else if (domain == "tile") {
+                instances.push_back({domain, name, korfTileInstance(4, s)});
+            } else if (domain == "pancake") {
+                instances.push_back({domain, name, pancakeInstance(16, s)});
+            } else if (domain == "racetrack") {
+                instances.push_back(
+                  {domain, name, raceTrackMap(64, 32, 0.1, s)});
+            } else {
+                cerr << "unknown domain: " << domain << "\n";
+                exit(1);
+            }
+        }
+    }
+    return instances;
+}
+
+template<class Domain>
+RunResult solveWith(Domain& domain, const string& expansion,
+                    const string& decision, size_t lookahead)
+{
+    auto search = SearchRegistry<Domain>::find(expansion, decision);
+
+    auto start = chrono::steady_clock::now();
+    auto res   = search(domain, lookahead, SearchOptions(), nullptr);
+    auto end   = chrono::steady_clock::now();
+
+    RunResult r;
+    r.solutionFound  = res.solutionFound;
+    r.solutionCost   = res.solutionCost;
+    r.solutionLength = res.solutionLength;
+    r.nodesExpanded  = res.nodesExpanded;
+    r.nodesGenerated = res.nodesGenerated;
+    r.seconds        = chrono::duration<double>(end - start).count();
+
+    auto steps = res.lookaheadCpuTime;
+    sort(steps.begin(), steps.end());
+    r.steps   = steps.size();
+    r.stepP50 = percentile(steps, 0.5);
+    r.stepP90 = percentile(steps, 0.9);
+    r.stepP99 = percentile(steps, 0.99);
+    r.stepMax = steps.empty() ? 0 : steps.back();
+
+    return r;
+}
+
+RunResult solve(const Instance& instance, const string& expansion,
+                const string& decision, size_t lookahead)
+{
+    stringstream in(instance.text);
+
+    if (instance.domain == "gridPathfinding") {
+        GridPathfinding world(in);
+        return solveWith(world, expansion, decision, lookahead);
+    } else if (instance.domain == "gridPathfindingWithTarPit") {
+        GridPathfindingWithTarPit world(in);
+        return solveWith(world, expansion, decision, lookahead);
+    } else if (instance.domain == "tile") {
+        SlidingTilePuzzle world(in);
+        return solveWith(world, expansion, decision, lookahead);
+    } else if (instance.domain == "pancake") {
+        PancakePuzzle world(in);
+        return solveWith(world, expansion, decision, lookahead);
+    }
+
+    RaceTrack world(in);
+    return solveWith(world, expansion, decision, lookahead);
+}
+
+nlohmann::json benchmarkRun(const Instance& instance, const string& expansion,
+                            const string& decision, size_t lookahead,
+                            unsigned int timeout)
+{
+    nlohmann::json record;
+    record["domain"]    = instance.domain;
+    record["instance"]  = instance.name;
+    record["algorithm"] = decision + "-" + expansion;
+    record["lookahead"] = lookahead;
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        cerr << "can not create pipe\n";
+        exit(1);
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        cerr << "can not fork\n";
+        exit(1);
+    }
+
+    if (pid == 0) {
+        close(fds[0]);
+        // domains print their map info on stdout
+        if (freopen("/dev/null", "w", stdout) == nullptr) {
+            _exit(1);
+        }
+        alarm(timeout);
+        RunResult r = solve(instance, expansion, decision, lookahead);
+        ssize_t   n = write(fds[1], &r, sizeof(r));
+        _exit(n == static_cast<ssize_t>(sizeof(r)) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    RunResult r;
+    size_t    got = 0;
+    while (got < sizeof(r)) {
+        ssize_t n =
+          read(fds[0], reinterpret_cast<char*>(&r) + got, sizeof(r) - got);
+        if (n <= 0) {
+            break;
+        }
+        got += static_cast<size_t>(n);
+    }
+    close(fds[0]);
+
+    int           status;
+    struct rusage usage;
+    wait4(pid, &status, 0, &usage);
+
+    // ru_maxrss is in kilobytes on linux
+    record["peak rss kb"] = usage.ru_maxrss;
+
+    if (WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM) {
+        record["status"] = "timeout";
+        return record;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || got != sizeof(r)) {
+        record["status"] = "crash";
+        return record;
+    }
+
+    record["status"]           = "ok";
+    record["solution found"]   = r.solutionFound;
+    record["solution cost"]    = r.solutionCost;
+    record["solution length"]  = r.solutionLength;
+    record["node expanded"]    = r.nodesExpanded;
+    record["node generated"]   = r.nodesGenerated;
+    record["seconds"]          = r.seconds;
+    record["nodes per second"] =
+      r.seconds > 0 ? static_cast<double>(r.nodesExpanded) / r.seconds : 0;
+    record["steps"]            = r.steps;
+    record["step latency p50"] = r.stepP50;
+    record["step latency p90"] = r.stepP90;
+    record["step latency p99"] = r.stepP99;
+    record["step latency max"] = r.stepMax;
+
+    return record;
+}
+
+int main(int argc, char** argv)
+{
+    cxxopts::Options options("./macroBench",
+                             "End-to-end benchmark on generated instances");
+
+    auto optionAdder = options.add_options();
+
+    optionAdder("d,domains", "comma separated domains",
+                cxxopts::value<std::string>()->default_value(
+                  "gridPathfinding,gridPathfindingWithTarPit,tile,pancake,"
+                  "racetrack"));
+
+    optionAdder("e,expan", "comma separated expansion algorithms",
+                cxxopts::value<std::string>()->default_value("astar,fhat"));
+
+    optionAdder("a,alg", "comma separated commit algorithms",
+                cxxopts::value<std::string>()->default_value(
+                  "one,alltheway,dtrts,dynamicLookahead"));
+
+    optionAdder("l,lookaheads", "comma separated expansion limits",
+                cxxopts::value<std::string>()->default_value("10,100,1000"));
+
+    optionAdder("n,instances", "instances per domain",
+                cxxopts::value<int>()->default_value("2"));
+
+    optionAdder("s,seed",
+                "seed of the first instance, also the solver's random seed",
+                cxxopts::value<int>()->default_value("1"));
+
+    optionAdder("t,timeout", "seconds per run",
+                cxxopts::value<int>()->default_value("60"));
+
+    optionAdder("o,out", "json out file (default: stdout)",
+                cxxopts::value<std::string>());
+
+    optionAdder("h,help", "Print usage");
+
+    auto args = options.parse(argc, argv);
+
+    if (args.count("help")) {
+        std::cout << options.help() << std::endl;
+        exit(0);
+    }
+
+    auto seed = static_cast<uint64_t>(args["seed"].as<int>());
+    RandomGenerator::defaultSeed() = seed;
+
+    auto instances = generateInstances(
+      split(args["domains"].as<std::string>()),
+      static_cast<size_t>(args["instances"].as<int>()), seed);
+    auto expansions = split(args["expan"].as<std::string>());
+    auto decisions  = split(args["alg"].as<std::string>());
+    auto lookaheads = split(args["lookaheads"].as<std::string>());
+    auto timeout    = static_cast<unsigned int>(args["timeout"].as<int>());
+
+    nlohmann::json runs = nlohmann::json::array();
+
+    for (const auto& instance : instances) {
+        for (const auto& expansion : expansions) {
+            for (const auto& decision : decisions) {
+                for (const auto& lookahead : lookaheads) {
+                    auto record = benchmarkRun(
+                      instance, expansion, decision,
+                      static_cast<size_t>(stoul(lookahead)), timeout);
+                    cerr << record << "\n";
+                    runs.push_back(record);
+                }
+            }
+        }
+    }
+
+    if (args.count("out")) {
+        ofstream out(args["out"].as<std::string>());
+        out << runs;
+        out.close();
+    } else {
+        cout << runs << endl;
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include "domain/GridPathfinding.h"
+#include "domain/GridPathfindingWithTarPit.h"
+#include "domain/HeavyTilePuzzle.h"
+#include "domain/InverseTilePuzzle.h"
+#include "domain/PancakePuzzle.h"
+#include "domain/RaceTrack.h"
+#include "domain/SlidingTilePuzzle.h"
+
+#include <istream>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+struct DomainOptions
+{
+    string domain;
+    string subDomain;
+    string heuristicType;
+    // binary map made by mapConverter, read instead of the map from the
+    // instance (racetrack then reads only its start from the instance)
+    string mapFile;
+};
+
+template<class Domain, class Setup>
+void setUpGrid(shared_ptr<Domain> world, const DomainOptions& options,
+               Setup&& setUp)
+{
+    if (options.heuristicType == "manhattan") {
+        world->setVariant(1);
+    } else if (options.heuristicType == "dijkstra") {
+        world->setVariant(2);
+    }
+
+    setUp(world);
+}
+
+// Build the domain `options` names from `instance` and hand it to
+// setUp(shared_ptr<Domain>), a generic lambda instantiated once per domain.
+// Returns false if the domain is unknown.
+template<class Setup>
+bool withDomain(const DomainOptions& options, istream& instance,
+                Setup&& setUp)
+{
+    const auto& domain    = options.domain;
+    const auto& subDomain = options.subDomain;
+
+    if (domain == "tile") {
+        if (subDomain == "heavy") {
+            setUp(std::make_shared<HeavyTilePuzzle>(instance));
+        } else if (subDomain == "inverse") {
+            setUp(std::make_shared<InverseTilePuzzle>(instance));
+        } else {
+            setUp(std::make_shared<SlidingTilePuzzle>(instance));
+        }
+    } else if (domain == "pancake") {
+        auto world = std::make_shared<PancakePuzzle>(instance);
+
+        if (subDomain == "heavy") {
+            world->setPuzzleVariant(1);
+        } else if (subDomain == "sumheavy") {
+            world->setPuzzleVariant(2);
+        }
+
+        if (options.heuristicType == "gapm1") {
+            world->setGapModifier(1);
+        } else if (options.heuristicType == "gapm2") {
+            world->setGapModifier(2);
+        }
+
+        setUp(world);
+    } else if (domain == "racetrack") {
+        shared_ptr<RaceTrack> world;
+
+        if (!options.mapFile.empty()) {
+            world = std::make_shared<RaceTrack>(options.mapFile, instance);
+        } else {
+            world = std::make_shared<RaceTrack>(instance);
+        }
+
+        // the racetrack defaults to its dijkstra map
+        if (options.heuristicType == "euclidean") {
+            world->setVariant(1);
+        }
+
+        setUp(world);
+    } else if (domain == "gridPathfinding") {
+        if (!options.mapFile.empty()) {
+            setUpGrid(std::make_shared<GridPathfinding>(options.mapFile),
+                      options, setUp);
+        } else {
+            setUpGrid(std::make_shared<GridPathfinding>(instance), options,
+                      setUp);
+        }
+    } else if (domain == "gridPathfindingWithTarPit") {
+        if (!options.mapFile.empty()) {
+            setUpGrid(
+              std::make_shared<GridPathfindingWithTarPit>(options.mapFile),
+              options, setUp);
+        } else {
+            setUpGrid(std::make_shared<GridPathfindingWithTarPit>(instance),
+                      options, setUp);
+        }
+    } else {
+        return false;
+    }
+
+    return true;
+}
@@ -5,22 +5,32 @@
 #include "expansionAlgorithms/MetaReasonAStar.h"
 #include "learningAlgorithms/MetaReasonDijkstra.h"
 #include "node.h"
+#include "utility/BucketQueue.h"
 #include "utility/PriorityQueue.h"
 #include "utility/ResultContainer.h"
+#include "utility/StateMap.h"
+#include "utility/TraceSink.h"
 #include <functional>
 #include <memory>
+#include <queue>
 #include <set>
-#include <unordered_map>
+#include <stack>
 #include <vector>
 
 #include <cassert>
+#include <chrono>
 #include <ctime>
 
 #include "utility/debug.h"
 
 using namespace std;
 
-template<class Domain>
+// The modules are template arguments, so the search loop calls them
+// directly; SearchRegistry picks the instantiation from the command line.
+// So is the open list: a BucketQueue in place of the heap for f-ordered
+// lookaheads on domains with integral costs.
+template<class Domain, class Expansion, class Decision, class Learning,
+         class Open = PriorityQueue<shared_ptr<SearchNode<Domain>>>>
 class RealTimeSearch
 {
 public:
@@ -29,250 +39,387 @@ public:
     typedef typename Domain::HashState Hash;
     using Node = SearchNode<Domain>;
 
-    RealTimeSearch(Domain& domain_, string expansionModule_,
-                   string decisionModule_, size_t lookahead_)
+    static constexpr CommitPolicy policy = Decision::policy;
+
+    RealTimeSearch(Domain& domain_, size_t lookahead_)
         : domain(domain_)
+        , metaReasonDecisionAlgo(domain, lookahead_)
+        , goalDecisionAlgo(domain, lookahead_)
+        , metaReasonExpansionAlgo(domain, lookahead_)
+        , metaReasonLearningAlgo(domain)
         , lookahead(lookahead_)
-        , decisionModule(decisionModule_)
-    {
-        if (decisionModule == "one" || decisionModule == "alltheway" ||
-            decisionModule == "dynamicLookahead") {
-            metaReasonDecisionAlgo =
-              make_shared<MetaReasonScalarBackup<Domain, Node>>(
-                decisionModule_);
-        } else if (decisionModule == "dtrts") {
-            metaReasonDecisionAlgo =
-              make_shared<MetaReasonNancyBackup<Domain, Node>>(
-                decisionModule_, domain, lookahead);
-        } else {
-            cerr << "unknown decision module: " << decisionModule << "\n";
-            exit(1);
-        }
+        , trace(nullptr)
+        , count(0)
+        , goalOnOpen(false)
+        , stepInProgress(false)
+    {}
 
-        if (expansionModule_ == "astar") {
-            metaReasonExpansionAlgo =
-              make_shared<MetaReasonAStar<Domain, Node>>(domain, lookahead,
-                                                         "f");
-        } else if (expansionModule_ == "fhat") {
-            metaReasonExpansionAlgo =
-              make_shared<MetaReasonAStar<Domain, Node>>(domain, lookahead,
-                                                         "fhat");
-        } else {
-            cerr << "unknown expansion module: " << expansionModule_ << "\n";
-            exit(1);
-        }
+    ~RealTimeSearch() { clean(); }
 
-        metaReasonLearningAlgo =
-          make_shared<MetaReasonDijkstra<Domain, Node>>(domain);
+    // stream paths, visited and committed states to `trace_`,
+    // nullptr turns tracing off
+    void setTraceSink(TraceSink* trace_)
+    {
+        trace = trace_;
+        metaReasonExpansionAlgo.setTraceSink(trace);
     }
 
-    ~RealTimeSearch() { clean(); }
+    // Keep at most `width` nodes on open, 0 for no limit, which makes each
+    // lookahead a beam search. A node pushed out of the beam stays in
+    // closed, generated but never to be expanded: the learning and the
+    // backups take it as part of the frontier like the nodes on open.
+    void setBeamWidth(size_t width) { limitOpen(open, width); }
+
+    // evaluate children's heuristics only once they reach the top of open,
+    // see MetaReasonAStar::setLazyHeuristic
+    void setLazyHeuristic(bool lazy)
+    {
+        metaReasonExpansionAlgo.setLazyHeuristic(lazy);
+    }
 
-    // p: iterationlimit
     ResultContainer search()
     {
         ResultContainer res;
 
-        shared_ptr<Node> initNode =
-          make_shared<Node>(0, domain.heuristic(domain.getStartState()),
-                            domain.distance(domain.getStartState()),
-                            domain.distanceErr(domain.getStartState()), 0, 0, 0,
-                            domain.getStartState(), nullptr);
+        reset();
+        while (step(res)) {
+        }
+
+        return res;
+    }
+
+    // start a new episode at the domain's start state
+    void reset()
+    {
+        count      = 0;
+        goalOnOpen = false;
+        observe(domain.getStartState());
+    }
+
+    // The agent is in `state`, wherever the plan put it: drop the planned
+    // actions, and the step being thought about if any, and think from
+    // there on the next step.
+    void observe(const State& state)
+    {
+        stepInProgress = false;
 
-        int count = 0;
+        shared_ptr<Node> node = make_shared<Node>(
+          0, domain.heuristic(state), domain.distance(state),
+          domain.distanceErr(state), 0, 0, state, nullptr);
 
-        queue<shared_ptr<Node>> actionQueue;
-        actionQueue.push(initNode);
-        shared_ptr<Node> start = initNode;
-        // if set a cutoff iteration
-        // while (count <= iterationlimit) {
-        while (1) {
+        actionQueue = queue<shared_ptr<Node>>();
+        actionQueue.push(node);
+        start = node;
+    }
+
+    // One think-and-act cycle: execute the actions committed so far, expand
+    // a lookahead from the new start, decide how much of it to commit and
+    // learn. The states committed to are appended to `committed` when
+    // given. Returns false once the goal is reached or the search runs into
+    // a dead end.
+    bool step(ResultContainer& res, vector<State>* committed = nullptr)
+    {
+        if (!beginStep(res)) {
+            return false;
+        }
+
+        think(res, [] { return false; });
+
+        return endStep(res, committed);
+    }
+
+    // The same cycle in pieces, for a caller that thinks in slices:
+    // beginStep(), think() as often as there is time for, then endStep().
+    // bestCommitment() can be asked in between.
+
+    // Execute the actions committed so far and set up the lookahead from
+    // the new start. Returns false once the goal is reached.
+    bool beginStep(ResultContainer& res)
+    {
+        if (traceLevel >= TRACE_SINK && trace) {
+            trace->setIteration(static_cast<size_t>(count));
+        }
+
+        if (policy == CommitPolicy::ONE) {
+            start = actionQueue.front();
+        }
+
+        if (commitsWholePath(policy)) {
+            vector<shared_ptr<Node>> curPath;
+            while (actionQueue.size() > 1) {
 
-            if (decisionModule == "one") {
                 start = actionQueue.front();
-            }
+                actionQueue.pop();
+                if (traceLevel >= TRACE_SINK && trace) {
+                    curPath.push_back(start);
+                }
+                res.solutionLength += 1;
+                res.solutionCost += domain.getEdgeCost(start->getState());
 
-            if (decisionModule == "alltheway" ||
-                decisionModule == "dynamicLookahead") {
-                vector<string> curPath;
-                while (actionQueue.size() > 1) {
-
-                    start = actionQueue.front();
-                    actionQueue.pop();
-                    curPath.push_back(start->getState().toString());
-                    res.solutionLength += 1;
-                    res.solutionCost += domain.getEdgeCost(start->getState());
-
-                    // lsslrta* try to optimize cpu time,
-                    // so even if more than one action are commited, it
-                    // will not use the time to thinking,
-                    // so we have to directly advance the "time"
-                    res.GATnodesExpanded += lookahead;
-
-                    if (domain.isGoal(start->getState())) {
-                        res.solutionFound = true;
-                        return res;
-                    }
+                // lsslrta* try to optimize cpu time,
+                // so even if more than one action are commited, it
+                // will not use the time to thinking,
+                // so we have to directly advance the "time"
+                res.GATnodesExpanded += lookahead;
+
+                if (domain.isGoal(start->getState())) {
+                    res.solutionFound = true;
+                    return false;
                 }
-                if (!curPath.empty()) {
-                    curPath.push_back(
-                      actionQueue.front()->getState().toString());
-                    res.paths.push_back(curPath);
+            }
+            if (!curPath.empty()) {
+                curPath.push_back(actionQueue.front());
+                trace->beginGroup(TracePhase::PATH);
+                for (const auto& n : curPath) {
+                    trace->state(TracePhase::PATH, n->getState());
                 }
-
-                start = actionQueue.front();
             }
 
-            // Check if a goal has been reached
-            // if yes, just clear the action queue
-            if (domain.isGoal(start->getState())) {
-                res.solutionFound = true;
-                // We stop thinking for metareason approach
-                // once the thinking frontier reach a goal
-                // ps: this loop should happen only once for one commit
-                while (actionQueue.size() > 0) {
-                    auto curAction = actionQueue.front();
-                    actionQueue.pop();
-                    vector<string> curPath;
-                    curPath.push_back(curAction->getState().toString());
-                    res.paths.push_back(curPath);
-                    vector<string> curVisitied;
-                    res.visited.push_back(curVisitied);
-                    res.isKeepThinkingFlags.push_back(false);
-                    vector<string> committed;
-                    res.committed.push_back(committed);
-                    res.solutionCost +=
-                      domain.getEdgeCost(curAction->getState());
-                    res.solutionLength += 1;
-
-                    // lsslrta* try to optimize cpu time,
-                    // so even if more than one action are commited, it
-                    // will not use the time to thinking,
-                    // so we have to directly advance the "time"
-                    res.GATnodesExpanded += lookahead;
-
-                    if (domain.isGoal(curAction->getState())) {
-                        return res;
-                    }
+            start = actionQueue.front();
+        }
+
+        // Check if a goal has been reached
+        // if yes, just clear the action queue
+        if (domain.isGoal(start->getState())) {
+            res.solutionFound = true;
+            // We stop thinking for metareason approach
+            // once the thinking frontier reach a goal
+            // ps: this loop should happen only once for one commit
+            while (actionQueue.size() > 0) {
+                auto curAction = actionQueue.front();
+                actionQueue.pop();
+                if (traceLevel >= TRACE_SINK && trace) {
+                    trace->singleton(TracePhase::PATH,
+                                     curAction->getState());
+                    trace->beginGroup(TracePhase::VISITED);
+                    trace->keepThinking(false);
+                    trace->beginGroup(TracePhase::COMMITTED);
+                }
+                res.solutionCost +=
+                  domain.getEdgeCost(curAction->getState());
+                res.solutionLength += 1;
+
+                // lsslrta* try to optimize cpu time,
+                // so even if more than one action are commited, it
+                // will not use the time to thinking,
+                // so we have to directly advance the "time"
+                res.GATnodesExpanded += lookahead;
+
+                if (domain.isGoal(curAction->getState())) {
+                    return false;
                 }
             }
+        }
 
-            restartLists(start);
-
-            // Expansion and Decision-making Phase
-            // check how many of the prefix should be commit
-            stack<shared_ptr<Node>> commitQueue;
-
-            // four metaReasoningDecisionAlgo
-            // 1. allways commit one, just like old nancy code
-            // 2. allways commit to frontier,  modify old nancy code
-            //    to return all nodes from root to the best frontier
-            // 3. dynamic fhat
-            // 4. fhat-pmr: need nancy backup from all frontier and
-            //    make decision on whether to commit each prefix based
-            //    on the hack rule
-            // 5. our approach: compute benefit of doing more search
-
-            // this loop should happen only once for approach 1-3
-            int  continueCounter = 0;
-            bool keepThinking    = false;
-            bool goalReached     = false;
-
-            while (commitQueue.empty() && !actionQueue.empty() &&
-                   !goalReached) {
-                // do more search
-                metaReasonExpansionAlgo->expand(open, closed,
-                                                duplicateDetection, res);
-                // deadend
-                if (open.empty() && !res.solutionFound) {
+        stepStart = chrono::steady_clock::now();
+
+        restartLists(start);
+
+        // Expansion and Decision-making Phase
+        // check how many of the prefix should be commit
+        commitQueue = stack<shared_ptr<Node>>();
+
+        // four metaReasoningDecisionAlgo
+        // 1. allways commit one, just like old nancy code
+        // 2. allways commit to frontier,  modify old nancy code
+        //    to return all nodes from root to the best frontier
+        // 3. dynamic fhat
+        // 4. fhat-pmr: need nancy backup from all frontier and
+        //    make decision on whether to commit each prefix based
+        //    on the hack rule
+        // 5. our approach: compute benefit of doing more search
+
+        // this loop should happen only once for approach 1-3
+        continueCounter     = 0;
+        keepThinking        = false;
+        goalReached         = false;
+        lookaheadInProgress = false;
+        thinkingDone        = false;
+        stepInProgress      = true;
+
+        return true;
+    }
+
+    // Expand lookaheads (and, for the thinking-while-acting decisions,
+    // execute the planned actions meanwhile) until the decision module
+    // commits or stop() says to hand control back. Returns true once
+    // thinking is done; after false, the next call resumes where this one
+    // stopped.
+    template<class Stop>
+    bool think(ResultContainer& res, Stop&& stop)
+    {
+        while (!thinkingDone) {
+            if (!lookaheadInProgress) {
+                if (!(commitQueue.empty() && !actionQueue.empty() &&
+                      !goalReached)) {
+                    thinkingDone = true;
                     break;
                 }
 
-                if (domain.isGoal(open.top()->getState())) {
-                    metaReasonDecisionAlgo =
-                      make_shared<MetaReasonScalarBackup<Domain, Node>>(
-                        "alltheway");
-                    goalReached = true;
-                }
+                // do more search
+                metaReasonExpansionAlgo.startLookahead(open);
+                lookaheadInProgress = true;
+            }
 
-                // meta-reason about how much to commit
-                commitQueue =
-                  metaReasonDecisionAlgo->backup(open, start, closed, false);
+            if (!metaReasonExpansionAlgo.expand(open, closed,
+                                                duplicateDetection, res,
+                                                stop)) {
+                return false;
+            }
 
-                DEBUG_MSG("start, ");
-                DEBUG_MSG(start->toString());
-                DEBUG_MSG("continue search: " << continueCounter);
-                DEBUG_MSG("commit size: " << commitQueue.size());
-                DEBUG_MSG("actionQ size: " << actionQueue.size());
+            finishLookahead(res);
+        }
 
-                auto n = actionQueue.front();
-                actionQueue.pop();
-                if (decisionModule != "alltheway" &&
-                    decisionModule != "dynamicLookahead") {
-                    vector<string> curPath;
-                    curPath.push_back(n->getState().toString());
-                    res.paths.push_back(curPath);
-                    res.isKeepThinkingFlags.push_back(keepThinking);
-                    keepThinking = true;
-                }
+        return true;
+    }
 
-                res.solutionCost += domain.getEdgeCost(n->getState());
-                res.solutionLength += 1;
-                ++continueCounter;
-                if (commitQueue.empty() && !actionQueue.empty()) {
-                    vector<string> committed;
-                    res.committed.push_back(committed);
-                }
-            }
+    // What the decision module would commit to if the step ended now,
+    // empty before the first lookahead has expanded its root.
+    vector<State> bestCommitment()
+    {
+        vector<State> states;
+        if (!stepInProgress || open.empty() || open.top() == start) {
+            return states;
+        }
 
-            // deadend
-            if (open.empty() && !res.solutionFound) {
-                DEBUG_MSG("deadend!");
-                break;
+        auto best = commitQueue;
+        if (best.empty()) {
+            best = goalOnOpen
+                     ? goalDecisionAlgo.preview(open, start, closed)
+                     : metaReasonDecisionAlgo.preview(open, start, closed);
+        }
+        while (!best.empty()) {
+            states.push_back(best.top()->getState());
+            best.pop();
+        }
+        return states;
+    }
+
+    // Stop thinking, cutting the current lookahead short if there is one,
+    // commit and learn. Returns false if the search ran into a dead end.
+    bool endStep(ResultContainer& res, vector<State>* committed = nullptr)
+    {
+        if (!thinkingDone) {
+            // the decision modules need at least the root expanded
+            think(res, [] { return true; });
+            if (lookaheadInProgress) {
+                finishLookahead(res);
             }
+            thinkingDone = true;
+        }
+        stepInProgress = false;
+
+        // deadend
+        if (open.empty() && !res.solutionFound) {
+            DEBUG_MSG("deadend!");
+            return false;
+        }
 
-            // if action queue is empty and metareasoning do not want to commit
+        // if action queue is empty and metareasoning do not want to commit
+        // force to commit at least one action
+        if (commitQueue.empty()) {
             // force to commit at least one action
-            if (commitQueue.empty()) {
-                // force to commit at least one action
-                commitQueue =
-                  metaReasonDecisionAlgo->backup(open, start, closed, true);
+            commitQueue = backup(true);
 
-                DEBUG_MSG("force commit, commit queue size "
-                          << commitQueue.size());
-            }
+            DEBUG_MSG("force commit, commit queue size "
+                      << commitQueue.size());
+        }
 
-            assert(commitQueue.size() > 0);
-            if (decisionModule == "dynamicLookahead") {
-                metaReasonExpansionAlgo->increaseLookahead(lookahead *
-                                                           commitQueue.size());
+        assert(commitQueue.size() > 0);
+        if (policy == CommitPolicy::DYNAMIC_LOOKAHEAD) {
+            metaReasonExpansionAlgo.increaseLookahead(lookahead *
+                                                      commitQueue.size());
+        }
+        if (traceLevel >= TRACE_SINK && trace) {
+            trace->beginGroup(TracePhase::COMMITTED);
+        }
+        while (!commitQueue.empty()) {
+            auto n = commitQueue.top();
+            DEBUG_MSG("commit: " << n->toString());
+            commitQueue.pop();
+            actionQueue.push(n);
+            start = n;
+            if (committed) {
+                committed->push_back(n->getState());
             }
-            vector<string> commited;
-            while (!commitQueue.empty()) {
-                auto n = commitQueue.top();
-                DEBUG_MSG("commit: " << n->toString());
-                commitQueue.pop();
-                actionQueue.push(n);
-                start = n;
-                commited.push_back(n->getState().toString());
+            if (traceLevel >= TRACE_SINK && trace) {
+                trace->state(TracePhase::COMMITTED, n->getState());
             }
-            res.committed.push_back(commited);
+        }
 
-            // LearninH Phase
-            metaReasonLearningAlgo->learn(open, closed);
+        // LearninH Phase
+        metaReasonLearningAlgo.learn(open, closed);
 
-            ++count;
-            DEBUG_MSG("iteration: " << count);
-        }
+        res.lookaheadCpuTime.push_back(
+          chrono::duration<double>(chrono::steady_clock::now() - stepStart)
+            .count());
 
-        return res;
+        ++count;
+        DEBUG_MSG("iteration: " << count);
+
+        return true;
     }
 
+    bool isStepInProgress() const { return stepInProgress; }
+
 private:
+    // the rest of one pass of the thinking loop, after its lookahead
+    void finishLookahead(ResultContainer& res)
+    {
+        lookaheadInProgress = false;
+        metaReasonExpansionAlgo.endLookahead(open, closed);
+
+        // deadend
+        if (open.empty() && !res.solutionFound) {
+            thinkingDone = true;
+            return;
+        }
+
+        if (domain.isGoal(open.top()->getState())) {
+            goalOnOpen  = true;
+            goalReached = true;
+        }
+
+        // meta-reason about how much to commit
+        commitQueue = backup(false);
+
+        DEBUG_MSG("start, ");
+        DEBUG_MSG(start->toString());
+        DEBUG_MSG("continue search: " << continueCounter);
+        DEBUG_MSG("commit size: " << commitQueue.size());
+        DEBUG_MSG("actionQ size: " << actionQueue.size());
+
+        auto n = actionQueue.front();
+        actionQueue.pop();
+        if (!commitsWholePath(policy)) {
+            if (traceLevel >= TRACE_SINK && trace) {
+                trace->singleton(TracePhase::PATH, n->getState());
+                trace->keepThinking(keepThinking);
+            }
+            keepThinking = true;
+        }
+
+        res.solutionCost += domain.getEdgeCost(n->getState());
+        res.solutionLength += 1;
+        ++continueCounter;
+        if (traceLevel >= TRACE_SINK && trace && commitQueue.empty() &&
+            !actionQueue.empty()) {
+            trace->beginGroup(TracePhase::COMMITTED);
+        }
+    }
+
+    stack<shared_ptr<Node>> backup(bool isForceCommit)
+    {
+        if (goalOnOpen) {
+            return goalDecisionAlgo.backup(open, start, closed, isForceCommit);
+        }
+        return metaReasonDecisionAlgo.backup(open, start, closed,
+                                             isForceCommit);
+    }
+
     static bool duplicateDetection(
       shared_ptr<Node>                              node,
-      unordered_map<State, shared_ptr<Node>, Hash>& closed,
-      PriorityQueue<shared_ptr<Node>>&              open)
+      StateMap<State, shared_ptr<Node>, Hash>& closed, Open& open)
     {
         // Check if this state exists
         auto it = closed.find(node->getState());
@@ -322,12 +469,26 @@ private:
         return false;
     }
 
-    void restartLists(shared_ptr<Node> start)
+    static void limitOpen(PriorityQueue<shared_ptr<Node>>& heap, size_t width)
+    {
+        heap.setCapacity(width == 0 ? numeric_limits<double>::infinity()
+                                    : static_cast<double>(width));
+    }
+
+    static void limitOpen(BucketQueue<Node>&, size_t width)
+    {
+        if (width != 0) {
+            cerr << "a BucketQueue open list cannot be bounded\n";
+            exit(1);
+        }
+    }
+
+    void restartLists(shared_ptr<Node> start_)
     {
         // mark this node as the start of the current search (to
         // prevent state pruning based on label)
-        start->markStart();
-        //start->resetStartEpsilons();
+        start_->markStart();
+        //start_->resetStartEpsilons();
         domain.resetStartEpsilons();
 
         // Empty OPEN and CLOSED
@@ -337,12 +498,12 @@ private:
         closed.clear();
 
         // reset start g as 0
-        start->setGValue(0);
+        start_->setGValue(0);
 
-        start->setParent(nullptr);
+        start_->setParent(nullptr);
 
-        open.push(start);
-        closed[start->getState()] = start;
+        open.push(start_);
+        closed[start_->getState()] = start_;
     }
 
     void clean()
@@ -361,13 +522,31 @@ private:
     }
 
 protected:
-    Domain&                                      domain;
-    shared_ptr<DecisionAlgorithm<Domain, Node>>  metaReasonDecisionAlgo;
-    shared_ptr<MetaReasonAStar<Domain, Node>>    metaReasonExpansionAlgo;
-    shared_ptr<MetaReasonDijkstra<Domain, Node>> metaReasonLearningAlgo;
-    PriorityQueue<shared_ptr<Node>>              open;
-    unordered_map<State, shared_ptr<Node>, Hash> closed;
-
-    size_t lookahead;
-    string decisionModule;
+    Domain&  domain;
+    Decision metaReasonDecisionAlgo;
+    MetaReasonScalarBackup<Domain, Node, CommitPolicy::ALL_THE_WAY>
+                                                 goalDecisionAlgo;
+    Expansion                                    metaReasonExpansionAlgo;
+    Learning                                     metaReasonLearningAlgo;
+    Open                                         open;
+    StateMap<State, shared_ptr<Node>, Hash> closed;
+
+    size_t     lookahead;
+    TraceSink* trace;
+
+    queue<shared_ptr<Node>> actionQueue;
+    shared_ptr<Node>        start;
+    int                     count;
+    // once a goal tops open, every later decision commits all the way
+    bool goalOnOpen;
+
+    // where the current step is, so it can be thought about in slices
+    stack<shared_ptr<Node>>          commitQueue;
+    chrono::steady_clock::time_point stepStart;
+    int                              continueCounter;
+    bool                             keepThinking;
+    bool                             goalReached;
+    bool                             lookaheadInProgress;
+    bool                             thinkingDone;
+    bool                             stepInProgress;
 };
@@ -0,0 +1,291 @@
+#pragma once
+#include "RealTimeSearch.h"
+#include "decisionAlgorithms/MetaReasonNancyBackup.h"
+#include "decisionAlgorithms/MetaReasonScalarBackup.h"
+#include "expansionAlgorithms/MetaReasonAStar.h"
+#include "expansionAlgorithms/PartialExpansionAStar.h"
+#include "learningAlgorithms/MetaReasonDijkstra.h"
+#include "node.h"
+#include "utility/BucketQueue.h"
+#include "utility/PriorityQueue.h"
+#include "utility/ResultContainer.h"
+#include "utility/ThinkingBudget.h"
+#include "utility/TraceSink.h"
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+// How a registry search runs, beyond its modules and lookahead.
+struct SearchOptions
+{
+    // bounds open (see RealTimeSearch::setBeamWidth), 0 for none
+    size_t beamWidth = 0;
+    // see RealTimeSearch::setLazyHeuristic
+    bool   lazyHeuristic = false;
+};
+
+// Every expansion x decision combination of RealTimeSearch for one domain,
+// instantiated at compile time. The command line picks one entry once at
+// startup; the search itself never looks at the module names again.
+template<class Domain>
+class SearchRegistry
+{
+    using State = typename Domain::State;
+    using Node  = SearchNode<Domain>;
+
+    template<OpenOrder order>
+    using AStar = MetaReasonAStar<Domain, Node, order>;
+
+    using PartialAStar = PartialExpansionAStar<Domain, Node>;
+
+    template<CommitPolicy policy>
+    using Scalar = MetaReasonScalarBackup<Domain, Node, policy>;
+
+    using Nancy            = MetaReasonNancyBackup<Domain, Node>;
+    using SpeculativeNancy = MetaReasonNancyBackup<Domain, Node, true>;
+    using Dijkstra         = MetaReasonDijkstra<Domain, Node>;
+
+    using Heap = PriorityQueue<shared_ptr<Node>>;
+
+    // the open list for domains with integral costs: buckets when the
+    // lookahead is f-ordered, the heap otherwise
+    template<class Expansion>
+    using IntegralOpen =
+      typename conditional<Expansion::openOrder == OpenOrder::F,
+                           BucketQueue<Node>, Heap>::type;
+
+    template<class Expansion, class Decision, class Open = Heap>
+    using Search = RealTimeSearch<Domain, Expansion, Decision, Dijkstra, Open>;
+
+public:
+    // A search driven one step at a time (see RealTimeSearch::step), the
+    // only virtual call is the one per step.
+    class Session
+    {
+    public:
+        virtual ~Session() = default;
+
+        virtual void reset()                                              = 0;
+        virtual void observe(const State& state)                          = 0;
+        virtual bool step(ResultContainer& res, vector<State>* committed) = 0;
+
+        // the step in slices, see RealTimeSearch::beginStep
+        virtual bool beginStep(ResultContainer& res) = 0;
+        virtual bool think(ResultContainer&      res,
+                           const ThinkingBudget& budget) = 0;
+        virtual vector<State> bestCommitment()           = 0;
+        virtual bool endStep(ResultContainer& res,
+                             vector<State>*   committed) = 0;
+        virtual bool isStepInProgress() const            = 0;
+    };
+
+    typedef ResultContainer (*Runner)(Domain& domain, size_t lookahead,
+                                      const SearchOptions& options,
+                                      TraceSink*           trace);
+    typedef unique_ptr<Session> (*SessionMaker)(
+      Domain& domain, size_t lookahead, const SearchOptions& options);
+
+    struct Entry
+    {
+        const char*  expansionModule;
+        const char*  decisionModule;
+        Runner       run;
+        SessionMaker makeSession;
+    };
+
+    // nullptr if the pair is unknown
+    static const Entry* lookup(const string& expansionModule,
+                               const string& decisionModule)
+    {
+        for (const auto& entry : entries()) {
+            if (expansionModule == entry.expansionModule &&
+                decisionModule == entry.decisionModule) {
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+
+    static Runner find(const string& expansionModule,
+                       const string& decisionModule)
+    {
+        auto found = lookup(expansionModule, decisionModule);
+        if (found) {
+            return found->run;
+        }
+
+        cerr << "unknown expansion/decision module: " << expansionModule
+             << "/" << decisionModule << ", available:";
+        for (const auto& entry : entries()) {
+            cerr << " " << entry.expansionModule << "/"
+                 << entry.decisionModule;
+        }
+        cerr << "\n";
+        exit(1);
+    }
+
+    static ResultContainer run(Domain& domain, const string& expansionModule,
+                               const string& decisionModule, size_t lookahead,
+                               const SearchOptions& options = SearchOptions(),
+                               TraceSink*           trace   = nullptr)
+    {
+        return find(expansionModule, decisionModule)(domain, lookahead,
+                                                     options, trace);
+    }
+
+    static const vector<Entry>& entries()
+    {
+        static const vector<Entry> table = [] {
+            vector<Entry> t;
+            addEntries<AStar<OpenOrder::F>>(t, "astar");
+            addEntries<AStar<OpenOrder::FHAT>>(t, "fhat");
+            addPartialEntries(t, HasOperatorTable<Domain>());
+            return t;
+        }();
+        return table;
+    }
+
+private:
+    template<class SearchAlg>
+    class SearchSession final : public Session
+    {
+    public:
+        SearchSession(Domain& domain, size_t lookahead,
+                      const SearchOptions& options)
+            : searchAlg(domain, lookahead)
+        {
+            configure(searchAlg, options);
+            searchAlg.reset();
+        }
+
+        void reset() override { searchAlg.reset(); }
+
+        void observe(const State& state) override { searchAlg.observe(state); }
+
+        bool step(ResultContainer& res, vector<State>* committed) override
+        {
+            return searchAlg.step(res, committed);
+        }
+
+        bool beginStep(ResultContainer& res) override
+        {
+            return searchAlg.beginStep(res);
+        }
+
+        bool think(ResultContainer& res, const ThinkingBudget& budget) override
+        {
+            return searchAlg.think(res, budget);
+        }
+
+        vector<State> bestCommitment() override
+        {
+            return searchAlg.bestCommitment();
+        }
+
+        bool endStep(ResultContainer& res, vector<State>* committed) override
+        {
+            return searchAlg.endStep(res, committed);
+        }
+
+        bool isStepInProgress() const override
+        {
+            return searchAlg.isStepInProgress();
+        }
+
+    private:
+        SearchAlg searchAlg;
+    };
+
+    // buckets only for an unbounded open; a beam needs the heap's worst
+    static bool useBuckets(const Domain&        domain,
+                           const SearchOptions& options)
+    {
+        return options.beamWidth == 0 && domain.hasIntegralCosts();
+    }
+
+    template<class SearchAlg>
+    static void configure(SearchAlg& searchAlg, const SearchOptions& options)
+    {
+        searchAlg.setBeamWidth(options.beamWidth);
+        searchAlg.setLazyHeuristic(options.lazyHeuristic);
+    }
+
+    template<class Expansion, class Decision>
+    static ResultContainer search(Domain& domain, size_t lookahead,
+                                  const SearchOptions& options,
+                                  TraceSink*           trace)
+    {
+        if (useBuckets(domain, options)) {
+            return searchWith<Search<Expansion, Decision,
+                                     IntegralOpen<Expansion>>>(
+              domain, lookahead, options, trace);
+        }
+        return searchWith<Search<Expansion, Decision>>(domain, lookahead,
+                                                       options, trace);
+    }
+
+    template<class SearchAlg>
+    static ResultContainer searchWith(Domain& domain, size_t lookahead,
+                                      const SearchOptions& options,
+                                      TraceSink*           trace)
+    {
+        SearchAlg searchAlg(domain, lookahead);
+
+        searchAlg.setTraceSink(trace);
+        configure(searchAlg, options);
+
+        return searchAlg.search();
+    }
+
+    template<class Expansion, class Decision>
+    static unique_ptr<Session> makeSession(Domain& domain, size_t lookahead,
+                                           const SearchOptions& options)
+    {
+        if (useBuckets(domain, options)) {
+            return unique_ptr<Session>(
+              new SearchSession<
+                Search<Expansion, Decision, IntegralOpen<Expansion>>>(
+                domain, lookahead, options));
+        }
+        return unique_ptr<Session>(
+          new SearchSession<Search<Expansion, Decision>>(domain, lookahead,
+                                                         options));
+    }
+
+    template<class Expansion, class Decision>
+    static Entry makeEntry(const char* expansionModule,
+                           const char* decisionModule)
+    {
+        return {expansionModule, decisionModule, &search<Expansion, Decision>,
+                &makeSession<Expansion, Decision>};
+    }
+
+    template<class Expansion>
+    static void addEntries(vector<Entry>& table, const char* expansionModule)
+    {
+        table.push_back(makeEntry<Expansion, Scalar<CommitPolicy::ONE>>(
+          expansionModule, "one"));
+        table.push_back(
+          makeEntry<Expansion, Scalar<CommitPolicy::ALL_THE_WAY>>(
+            expansionModule, "alltheway"));
+        table.push_back(
+          makeEntry<Expansion, Scalar<CommitPolicy::DYNAMIC_LOOKAHEAD>>(
+            expansionModule, "dynamicLookahead"));
+        table.push_back(makeEntry<Expansion, Nancy>(expansionModule, "dtrts"));
+        table.push_back(makeEntry<Expansion, SpeculativeNancy>(
+          expansionModule, "dtrtsSpeculative"));
+    }
+
+    // partial expansion only for the domains with an operator table
+    static void addPartialEntries(vector<Entry>& table, true_type)
+    {
+        addEntries<PartialAStar>(table, "epea");
+    }
+
+    static void addPartialEntries(vector<Entry>&, false_type) {}
+};
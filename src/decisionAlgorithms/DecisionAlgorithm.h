@@ -1,9 +1,24 @@
 #pragma once
 #include "../utility/PriorityQueue.h"
+#include "../utility/StateMap.h"
 #include <functional>
 #include <memory>
 #include <stack>
-#include <unordered_map>
+
+// how much of the best lookahead path a decision module commits to
+enum class CommitPolicy
+{
+    ONE,               // one action towards the best frontier node
+    ALL_THE_WAY,       // the whole path to the best frontier node
+    DYNAMIC_LOOKAHEAD, // the whole path, and grow the lookahead with it
+    DTRTS              // as many prefix actions as the nancy backup trusts
+};
+
+inline constexpr bool commitsWholePath(CommitPolicy policy)
+{
+    return policy == CommitPolicy::ALL_THE_WAY ||
+           policy == CommitPolicy::DYNAMIC_LOOKAHEAD;
+}
 
 template<class Domain, class Node>
 class DecisionAlgorithm
@@ -13,10 +28,21 @@ class DecisionAlgorithm
     typedef typename Domain::HashState Hash;
 
 public:
-    virtual stack<shared_ptr<Node>> backup(
-      const PriorityQueue<shared_ptr<Node>>& open, shared_ptr<Node> start,
-      const unordered_map<State, shared_ptr<Node>, Hash>& closed_,
-      const bool                                          isForceCommit) = 0;
+    // A decision module provides, for whichever open list the search keeps
+    // (a PriorityQueue or a BucketQueue of shared_ptr<Node>):
+    //
+    //   template<class Open>
+    //   stack<shared_ptr<Node>> backup(const Open& open,
+    //     shared_ptr<Node> start,
+    //     const StateMap<State, shared_ptr<Node>, Hash>& closed,
+    //     bool isForceCommit);
+    //
+    //   // what a forced backup would commit to now, leaving the search as
+    //   // it is
+    //   template<class Open>
+    //   stack<shared_ptr<Node>> preview(const Open& open,
+    //     shared_ptr<Node> start,
+    //     const StateMap<State, shared_ptr<Node>, Hash>& closed);
 
     virtual ~DecisionAlgorithm() = default;
 };
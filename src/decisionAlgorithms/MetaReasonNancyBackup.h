@@ -1,8 +1,11 @@
 #pragma once
+#include "../utility/CostTraits.h"
 #include "../utility/NormalDistribution.h"
-#include "../utility/PriorityQueue.h"
+#include "../utility/RadixHeap.h"
 #include "../utility/debug.h"
 #include "DecisionAlgorithm.h"
+#include "SpeculativeLookahead.h"
+#include <algorithm>
 #include <cassert>
 #include <functional>
 #include <memory>
@@ -10,28 +13,53 @@
 
 using namespace std;
 
-template<class Domain, class Node>
-class MetaReasonNancyBackup : public DecisionAlgorithm<Domain, Node>
+// With `speculative`, whether searching further would change the choice
+// between alpha and beta is measured by short lookaheads from both on worker
+// threads (SpeculativeLookahead) rather than predicted from the expansion
+// delay alone.
+template<class Domain, class Node, bool speculative = false>
+class MetaReasonNancyBackup final : public DecisionAlgorithm<Domain, Node>
 {
     typedef typename Domain::State     State;
     typedef typename Domain::Cost      Cost;
     typedef typename Domain::HashState Hash;
 
 public:
-    MetaReasonNancyBackup(string& decisionModule_, Domain& domain_,
-                          size_t lookahead_)
-        : decisionModule(decisionModule_)
-        , domain(domain_)
+    static constexpr CommitPolicy policy = CommitPolicy::DTRTS;
+
+    MetaReasonNancyBackup(Domain& domain_, size_t lookahead_)
+        : domain(domain_)
         , lookahead(lookahead_)
     {}
 
+    template<class Open>
     stack<shared_ptr<Node>> backup(
-      const PriorityQueue<shared_ptr<Node>>& open, shared_ptr<Node> start,
-      const unordered_map<State, shared_ptr<Node>, Hash>& closed_,
+      const Open& open, shared_ptr<Node> start,
+      const StateMap<State, shared_ptr<Node>, Hash>& closed_,
       const bool                                          isForceCommit)
+    {
+        return backup(open, start, closed_, isForceCommit, true);
+    }
+
+    // Mid-lookahead, closed nodes whose subtrees have not reached open yet
+    // would look like dead ends; leave them be.
+    template<class Open>
+    stack<shared_ptr<Node>> preview(
+      const Open& open, shared_ptr<Node> start,
+      const StateMap<State, shared_ptr<Node>, Hash>& closed_)
+    {
+        return backup(open, start, closed_, true, false);
+    }
+
+protected:
+    template<class Open>
+    stack<shared_ptr<Node>> backup(
+      const Open& open, shared_ptr<Node> start,
+      const StateMap<State, shared_ptr<Node>, Hash>& closed_,
+      const bool isForceCommit, const bool markDeadEnds)
     {
         closed = closed_;
-        dijkstraNancyBackup(open, closed_);
+        dijkstraNancyBackup(open, markDeadEnds);
         stack<shared_ptr<Node>> commitedNodes;
         prefixDeepThinking(start, commitedNodes);
 
@@ -48,33 +76,46 @@ public:
         return commitedNodes;
     }
 
-protected:
-    void dijkstraNancyBackup(
-      PriorityQueue<shared_ptr<Node>>              open,
-      unordered_map<State, shared_ptr<Node>, Hash> closedCopy)
+    template<class Open>
+    void dijkstraNancyBackup(const Open& open, bool markDeadEnds)
     {
+        closedCopy = closed;
+        backups.clear();
+
         // Start by initializing every state in closed to inf hhat
         for (auto it = closedCopy.begin(); it != closedCopy.end(); it++) {
-            it->second->setBackupHHat(numeric_limits<double>::infinity());
+            auto& node = it->second;
+            if (node->onOpen() && !open.contains(node)) {
+                // the beam pushed it off open; it backs up like those on it
+                setBackupHHat(node, node->getHHatValue());
+                setNancyFrontier(node, node);
+                frontier.push(backupHHat(node), node);
+                continue;
+            }
+            setBackupHHat(node, numeric_limits<double>::infinity());
             // DEBUG_MSG("dijksttra closed:" + it->second->toString());
         }
 
-        // initialiizing every node on open to its hhat
+        // initialiizing every node on open to its hhat, ordered by it
         for (auto node : open) {
-            node->setBackupHHat(node->getHHatValue());
-            node->setNancyFrontier(node);
+            setBackupHHat(node, node->getHHatValue());
+            setNancyFrontier(node, node);
+            frontier.push(backupHHat(node), node);
             // DEBUG_MSG("dijksttra open:" + node->toString());
         }
 
-        // Order open by hhat
-        open.swapComparator(Node::compareNodesBackedHHat);
-
-        while (!open.empty()) {
-            auto cur = open.top();
-            open.pop();
+        while (!frontier.empty()) {
+            auto   cur = frontier.top();
+            double key = frontier.topKey();
+            frontier.pop();
             // DEBUG_MSG("dijksttra state" + cur->toString());
 
-            closedCopy.erase(cur->getState());
+            // an entry superseded by a later push, or a node already done
+            if (key != backupHHat(cur) ||
+                closedCopy.erase(cur->getState()) == 0) {
+                continue;
+            }
+
             auto preds = domain.predecessors(cur->getState());
 
             for (const auto& s : preds) {
@@ -87,30 +128,29 @@ protected:
                 auto parentNode = it->second;
                 auto edgeCost   = domain.getEdgeCost(cur->getState());
 
-                if (parentNode->getBackupHHatValue() <=
-                    edgeCost + cur->getBackupHHatValue()) {
+                if (backupHHat(parentNode) <=
+                    edgeCost + backupHHat(cur)) {
                     continue;
                 }
 
-                parentNode->setBackupHHat(edgeCost + cur->getBackupHHatValue());
-                parentNode->setNancyFrontier(cur->getNancyFrontier());
-
-                if (open.find(parentNode) == open.end()) {
-                    open.push(parentNode);
-                } else {
-                    open.update(parentNode);
-                }
+                setBackupHHat(parentNode, edgeCost + backupHHat(cur));
+                setNancyFrontier(parentNode, nancyFrontier(cur));
+                frontier.push(backupHHat(parentNode), parentNode);
             }
         }
 
+        if (!markDeadEnds) {
+            return;
+        }
+
         // everything else in the closed is deadend
         for (auto it = closedCopy.begin(); it != closedCopy.end(); it++) {
-            it->second->setHValue(numeric_limits<double>::infinity());
+            it->second->setHValue(CostTraits<Cost>::infinity());
             it->second->setDValue(numeric_limits<double>::infinity());
             it->second->setDErrValue(numeric_limits<double>::infinity());
             it->second->setEpsilonH(0);
             it->second->setEpsilonD(0);
-            it->second->setNancyFrontier(it->second);
+            setNancyFrontier(it->second, it->second);
         }
     }
 
@@ -162,9 +202,9 @@ protected:
         }
 
         DEBUG_MSG("alpha " + alpha->toString());
-        DEBUG_MSG("alpha frontier" + alpha->getNancyFrontier()->toString());
+        DEBUG_MSG("alpha frontier" + nancyFrontier(alpha)->toString());
         DEBUG_MSG("beta " + beta->toString());
-        DEBUG_MSG("beta frontier" + beta->getNancyFrontier()->toString());
+        DEBUG_MSG("beta frontier" + nancyFrontier(beta)->toString());
 
         auto pChooseAlpha = getPChooseAlpha(alpha, beta, timeStep);
 
@@ -185,25 +225,58 @@ protected:
     double getPChooseAlpha(shared_ptr<Node> alpha, shared_ptr<Node> beta,
                            int timeStep)
     {
+        if (speculative) {
+            return getPChooseAlphaSpeculatively(alpha, beta, timeStep);
+        }
+
         auto pAlpha = distributionAfterSearch(alpha, timeStep / 2.0);
         auto pBeta  = distributionAfterSearch(beta, timeStep / 2.0);
 
         return computeProbOfd1IsLowerCost(pAlpha, pBeta);
     }
 
-    Cost commitUtility(shared_ptr<Node> alpha, int timeStep)
+    // Search from alpha and beta in parallel for half a lookahead each
+    // (the first part of the time distributionAfterSearch assumes each
+    // gets), then expect their measured f-hats to move only as much as the
+    // rest of that time allows.
+    double getPChooseAlphaSpeculatively(shared_ptr<Node> alpha,
+                                        shared_ptr<Node> beta, int timeStep)
+    {
+        size_t budget = max(lookahead / 2, static_cast<size_t>(1));
+        if (!speculation) {
+            speculation.reset(
+              new SpeculativeLookahead<Domain, Node>(domain, 2, budget));
+        }
+
+        auto measured = speculation->measure(
+          {alpha, beta}, closed, domain.getGlobalEpsilonH(),
+          domain.getGlobalEpsilonD());
+
+        double remaining =
+          max(0.0, timeStep / 2.0 - static_cast<double>(budget) /
+                                      static_cast<double>(lookahead));
+
+        NormalDistribution pAlpha(
+          measured[0], distributionAfterSearch(alpha, remaining).getVar());
+        NormalDistribution pBeta(
+          measured[1], distributionAfterSearch(beta, remaining).getVar());
+
+        return computeProbOfd1IsLowerCost(pAlpha, pBeta);
+    }
+
+    double commitUtility(shared_ptr<Node> alpha, int timeStep)
     {
         auto alphaalpha = getAlpha(alpha);
         auto alphabeta  = getBeta(alpha);
 
         if (alphaalpha == nullptr && alphabeta == nullptr) {
             DEBUG_MSG("no alphaAlpha and alphaBeta");
-            return alpha->getNancyFrontier()->getFHatValue();
+            return nancyFrontier(alpha)->getFHatValue();
         }
 
         if (alphabeta == nullptr) {
             DEBUG_MSG("no alphaBeta");
-            return alphaalpha->getNancyFrontier()->getFHatValue();
+            return nancyFrontier(alphaalpha)->getFHatValue();
         }
 
         DEBUG_MSG("aa " << alphaalpha->toString());
@@ -219,15 +292,15 @@ protected:
         return expectedMinimum(pAlphaalpha, pAlphabeta);
     }
 
-    Cost notCommitUtility(shared_ptr<Node> alpha, shared_ptr<Node> beta,
-                          double pChooseAlpha, int timeStep)
+    double notCommitUtility(shared_ptr<Node> alpha, shared_ptr<Node> beta,
+                            double pChooseAlpha, int timeStep)
     {
         auto alphaalpha = getAlpha(alpha);
         auto alphabeta  = getBeta(alpha);
         auto betaalpha  = getAlpha(beta);
         auto betabeta   = getBeta(beta);
 
-        double utilityOfAlpha = alpha->getNancyFrontier()->getFHatValue();
+        double utilityOfAlpha = nancyFrontier(alpha)->getFHatValue();
 
         if (alphaalpha != nullptr && alphabeta != nullptr) {
             // DEBUG_MSG("has both kids for alpha, in nCMT");
@@ -239,7 +312,7 @@ protected:
             utilityOfAlpha = expectedMinimum(pAlphaalpha, pAlphabeta);
         }
 
-        auto utilityOfBeta = beta->getNancyFrontier()->getFHatValue();
+        auto utilityOfBeta = nancyFrontier(beta)->getFHatValue();
 
         if (betaalpha != nullptr && betabeta != nullptr) {
             // DEBUG_MSG("has both kids for beta, in nCMT");
@@ -264,7 +337,7 @@ protected:
         vector<State> children = domain.successors(node->getState());
 
         shared_ptr<Node> bestChild;
-        Cost             bestFHat = numeric_limits<double>::infinity();
+        double           bestFHat = numeric_limits<double>::infinity();
 
         // DEBUG_MSG("getAlph on state " + node->toString());
         for (State child : children) {
@@ -282,15 +355,15 @@ protected:
 
             // DEBUG_MSG("getAlphh work on kid " + childNode->toString());
             // DEBUG_MSG("getAlphh work on kid's nancyfront" +
-            // childNode->getNancyFrontier()->toString());
+            // nancyFrontier(childNode)->toString());
             if ((bestChild &&
-                 childNode->getNancyFrontier()->getFHatValue() == bestFHat &&
+                 nancyFrontier(childNode)->getFHatValue() == bestFHat &&
                  // break tie on high g
-                 childNode->getNancyFrontier()->getGValue() >
-                   bestChild->getNancyFrontier()->getGValue()) ||
-                (childNode->getNancyFrontier()->getFHatValue() < bestFHat)) {
+                 nancyFrontier(childNode)->getGValue() >
+                   nancyFrontier(bestChild)->getGValue()) ||
+                (nancyFrontier(childNode)->getFHatValue() < bestFHat)) {
                 bestChild = childNode;
-                bestFHat  = childNode->getNancyFrontier()->getFHatValue();
+                bestFHat  = nancyFrontier(childNode)->getFHatValue();
 
                 // DEBUG_MSG("is best and best fhat " << bestFHat);
             }
@@ -310,7 +383,7 @@ protected:
 
         shared_ptr<Node> bestChild = getAlpha(node);
         shared_ptr<Node> secondBestChild;
-        Cost             secondBestFHat = numeric_limits<double>::infinity();
+        double           secondBestFHat = numeric_limits<double>::infinity();
 
         for (State child : children) {
             auto it = closed.find(child);
@@ -325,11 +398,11 @@ protected:
 
             auto childNode = it->second;
 
-            if (childNode->getNancyFrontier()->getFHatValue() <
+            if (nancyFrontier(childNode)->getFHatValue() <
                   secondBestFHat &&
                 childNode != bestChild) {
                 secondBestChild = childNode;
-                secondBestFHat  = childNode->getNancyFrontier()->getFHatValue();
+                secondBestFHat  = nancyFrontier(childNode)->getFHatValue();
             }
         }
 
@@ -345,7 +418,7 @@ protected:
     NormalDistribution distributionAfterSearch(shared_ptr<Node> node,
                                                double timeStepFraction)
     {
-        auto mean = node->getNancyFrontier()->getFHatValue();
+        auto mean = nancyFrontier(node)->getFHatValue();
         // Just use global delay
         // version 2 try path based expansion delay?
         double ds =
@@ -356,16 +429,16 @@ protected:
         // node->getDValue();
 
         // we are using path-based heuristic error here
-        // auto var = pow(node->getNancyFrontier()->getPathBasedEpsilonH() *
-        auto var = pow(node->getNancyFrontier()->getEpsilonH() *
-                         node->getNancyFrontier()->getDValue(),
+        // auto var = pow(nancyFrontier(node)->getPathBasedEpsilonH() *
+        auto var = pow(nancyFrontier(node)->getEpsilonH() *
+                         nancyFrontier(node)->getDValue(),
                        2.0) *
-                   min(1.0, ds / node->getNancyFrontier()->getDValue());
+                   min(1.0, ds / nancyFrontier(node)->getDValue());
 
         // DEBUG_MSG("epsilonh " +
-        // to_string(node->getNancyFrontier()->getPathBasedEpsilonH()));
+        // to_string(nancyFrontier(node)->getPathBasedEpsilonH()));
         // DEBUG_MSG("ds " + to_string(ds));
-        // DEBUG_MSG("dab " + to_string(node->getNancyFrontier()->getDValue()));
+        // DEBUG_MSG("dab " + to_string(nancyFrontier(node)->getDValue()));
         // DEBUG_MSG("mean " + to_string(mean) + " var " + to_string(var));
         return NormalDistribution(mean, var);
     }
@@ -391,8 +464,57 @@ protected:
         return expMin;
     }
 
-    string                                       decisionModule;
-    Domain&                                      domain;
-    size_t                                       lookahead;
-    unordered_map<State, shared_ptr<Node>, Hash> closed;
+    // What the backup learns about a node of the lookahead: its backed-up
+    // h-hat and the frontier node it comes from. Kept here rather than in
+    // SearchNode, so only a search that decides with this module pays for
+    // it.
+    struct Backup
+    {
+        double      hHat     = 0;
+        const Node* frontier = nullptr;
+    };
+
+    Backup& backupOf(const shared_ptr<Node>& node)
+    {
+        return backups[node.get()];
+    }
+
+    double backupHHat(const shared_ptr<Node>& node)
+    {
+        return backupOf(node).hHat;
+    }
+
+    void setBackupHHat(const shared_ptr<Node>& node, double hHat)
+    {
+        backupOf(node).hHat = hHat;
+    }
+
+    const Node* nancyFrontier(const shared_ptr<Node>& node)
+    {
+        return backupOf(node).frontier;
+    }
+
+    void setNancyFrontier(const shared_ptr<Node>& node, const Node* frontier_)
+    {
+        backupOf(node).frontier = frontier_;
+    }
+
+    void setNancyFrontier(const shared_ptr<Node>& node,
+                          const shared_ptr<Node>& frontier_)
+    {
+        setNancyFrontier(node, frontier_.get());
+    }
+
+    Domain&                                 domain;
+    size_t                                  lookahead;
+    StateMap<State, shared_ptr<Node>, Hash> closed;
+    // what the backup has not reached yet, a member so it keeps its capacity
+    StateMap<State, shared_ptr<Node>, Hash> closedCopy;
+    // every node of the last backup, cleared at the start of the next
+    EpochMap<const Node*, Backup> backups;
+    // the backup's frontier, kept between calls so its buckets keep their
+    // capacity
+    RadixHeap<shared_ptr<Node>> frontier;
+    // started on the first speculative decision
+    unique_ptr<SpeculativeLookahead<Domain, Node>> speculation;
 };
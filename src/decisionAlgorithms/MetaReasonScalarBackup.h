@@ -6,30 +6,30 @@
 
 using namespace std;
 
-template<class Domain, class Node>
+template<class Domain, class Node, CommitPolicy policy_>
 // class ScalarBackup
-class MetaReasonScalarBackup : public DecisionAlgorithm<Domain, Node>
+class MetaReasonScalarBackup final : public DecisionAlgorithm<Domain, Node>
 {
     typedef typename Domain::State     State;
     typedef typename Domain::Cost      Cost;
     typedef typename Domain::HashState Hash;
 
 public:
-    MetaReasonScalarBackup(string decisionModule_)
-        : decisionModule(decisionModule_)
-    {}
+    static constexpr CommitPolicy policy = policy_;
 
+    MetaReasonScalarBackup(Domain&, size_t) {}
+
+    template<class Open>
     stack<shared_ptr<Node>> backup(
-      const PriorityQueue<shared_ptr<Node>>& open, shared_ptr<Node> start,
-      const unordered_map<State, shared_ptr<Node>, Hash>&, const bool)
+      const Open& open, shared_ptr<Node> start,
+      const StateMap<State, shared_ptr<Node>, Hash>&, const bool)
     {
         stack<shared_ptr<Node>> commitedNodes;
         shared_ptr<Node>        goalPrime = open.top();
 
         // Only move one step towards best on open
         while (goalPrime->getParent() != start) {
-            if (decisionModule == "alltheway" ||
-                decisionModule == "dynamicLookahead") {
+            if (commitsWholePath(policy)) {
                 commitedNodes.push(goalPrime);
             }
 
@@ -41,6 +41,11 @@ public:
         return commitedNodes;
     }
 
-protected:
-    string decisionModule;
+    template<class Open>
+    stack<shared_ptr<Node>> preview(
+      const Open& open, shared_ptr<Node> start,
+      const StateMap<State, shared_ptr<Node>, Hash>& closed_)
+    {
+        return backup(open, start, closed_, true);
+    }
 };
@@ -0,0 +1,228 @@
+#pragma once
+#include "../utility/CostTraits.h"
+#include "../utility/PriorityQueue.h"
+#include "../utility/StateMap.h"
+
+#include <condition_variable>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Short f-hat ordered lookaheads on worker threads, measuring what a node's
+// backed-up f-hat becomes after more search instead of predicting it.
+//
+// Every worker searches its own copy of the domain, made when the pool
+// starts, since looking up a heuristic or generating successors writes to
+// the domain's tables. States the caller's lookahead holds take their h, d
+// and derr from the caller's nodes instead, so what the search has learned
+// since the copies were made still counts there. Those nodes are only read,
+// and only while the caller waits in measure().
+template<class Domain, class Node>
+class SpeculativeLookahead
+{
+    typedef typename Domain::State                       State;
+    typedef typename Domain::Cost                        Cost;
+    typedef typename Domain::HashState                   Hash;
+    typedef CostTraits<Cost>                             Traits;
+    typedef StateMap<State, shared_ptr<Node>, Hash> Known;
+
+public:
+    SpeculativeLookahead(const Domain& domain, size_t workerCount,
+                         size_t budget_)
+        : budget(budget_)
+        , generation(0)
+        , pending(0)
+        , stopping(false)
+        , known(nullptr)
+        , epsilonH(0)
+        , epsilonD(0)
+    {
+        for (size_t i = 0; i < workerCount; ++i) {
+            workers.emplace_back(new Worker(domain));
+        }
+        for (auto& worker : workers) {
+            Worker* w     = worker.get();
+            worker->agent = thread([this, w] { run(*w); });
+        }
+    }
+
+    ~SpeculativeLookahead()
+    {
+        {
+            lock_guard<mutex> lock(jobs);
+            stopping = true;
+        }
+        jobReady.notify_all();
+        for (auto& worker : workers) {
+            worker->agent.join();
+        }
+    }
+
+    SpeculativeLookahead(const SpeculativeLookahead&) = delete;
+    SpeculativeLookahead& operator=(const SpeculativeLookahead&) = delete;
+
+    size_t workerCount() const { return workers.size(); }
+
+    // The lowest f-hat on open after `budget` expansions from each of
+    // `roots` (at most one root per worker), searched in parallel: the
+    // g-value of a goal reached first, infinity if the search runs dry.
+    vector<double> measure(const vector<shared_ptr<Node>>& roots,
+                           const Known& known_, double epsilonH_,
+                           double epsilonD_)
+    {
+        unique_lock<mutex> lock(jobs);
+
+        known    = &known_;
+        epsilonH = epsilonH_;
+        epsilonD = epsilonD_;
+        for (size_t i = 0; i < workers.size(); ++i) {
+            workers[i]->root = i < roots.size() ? roots[i] : nullptr;
+        }
+        pending = workers.size();
+        ++generation;
+
+        jobReady.notify_all();
+        jobDone.wait(lock, [this] { return pending == 0; });
+
+        vector<double> results;
+        for (size_t i = 0; i < roots.size(); ++i) {
+            results.push_back(workers[i]->result);
+        }
+        known = nullptr;
+        return results;
+    }
+
+private:
+    struct Worker
+    {
+        explicit Worker(const Domain& domain_)
+            : domain(domain_)
+            , result(0)
+            , seen(0)
+        {}
+
+        Domain           domain;
+        thread           agent;
+        shared_ptr<Node> root;
+        double           result;
+        size_t           seen;
+    };
+
+    void run(Worker& worker)
+    {
+        unique_lock<mutex> lock(jobs);
+        for (;;) {
+            jobReady.wait(lock, [&] {
+                return stopping || generation != worker.seen;
+            });
+            if (stopping) {
+                return;
+            }
+            worker.seen = generation;
+
+            if (worker.root) {
+                lock.unlock();
+                double result = search(worker.domain, worker.root);
+                lock.lock();
+                worker.result = result;
+                worker.root   = nullptr;
+            }
+
+            if (--pending == 0) {
+                jobDone.notify_one();
+            }
+        }
+    }
+
+    double search(Domain& domain, const shared_ptr<Node>& root)
+    {
+        PriorityQueue<shared_ptr<Node>> open;
+        Known                           closed;
+
+        open.swapComparator(Node::compareNodesFHat);
+
+        auto start = make_shared<Node>(
+          root->getGValue(), root->getHValue(), root->getDValue(),
+          root->getDErrValue(), epsilonH, epsilonD, root->getState(), nullptr);
+        open.push(start);
+        closed[start->getState()] = start;
+
+        for (size_t expansions = 0; expansions < budget && !open.empty();
+             ++expansions) {
+            shared_ptr<Node> cur = open.top();
+            if (domain.isGoal(cur->getState())) {
+                return Traits::toDouble(cur->getGValue());
+            }
+
+            open.pop();
+            cur->close();
+
+            for (const State& child : domain.successors(cur->getState())) {
+                Cost g  = cur->getGValue() + domain.getEdgeCost(child);
+                auto it = closed.find(child);
+
+                if (it != closed.end()) {
+                    auto& node = it->second;
+                    if (node->onOpen() ? g >= node->getGValue()
+                                       : Traits::sum(g, node->getHValue()) >=
+                                           node->getFValue()) {
+                        continue;
+                    }
+
+                    node->setGValue(g);
+                    node->setParent(cur);
+                    if (node->onOpen()) {
+                        open.update(node);
+                    } else {
+                        node->reOpen();
+                        open.push(node);
+                    }
+                    continue;
+                }
+
+                shared_ptr<Node> childNode;
+                auto             learned = known->find(child);
+                if (learned != known->end()) {
+                    childNode = make_shared<Node>(
+                      g, learned->second->getHValue(),
+                      learned->second->getDValue(),
+                      learned->second->getDErrValue(), epsilonH, epsilonD,
+                      child, cur);
+                } else {
+                    childNode = make_shared<Node>(
+                      g, domain.heuristic(child), domain.distance(child),
+                      domain.distanceErr(child), epsilonH, epsilonD, child,
+                      cur);
+                }
+
+                open.push(childNode);
+                closed[child] = childNode;
+            }
+        }
+
+        if (open.empty()) {
+            return numeric_limits<double>::infinity();
+        }
+        return open.top()->getFHatValue();
+    }
+
+    const size_t budget;
+
+    vector<unique_ptr<Worker>> workers;
+
+    // the current job, guarded by `jobs`; `known` and the epsilons are
+    // read without the lock while the caller waits in measure()
+    mutex              jobs;
+    condition_variable jobReady;
+    condition_variable jobDone;
+    size_t             generation;
+    size_t             pending;
+    bool               stopping;
+    const Known*       known;
+    double             epsilonH;
+    double             epsilonD;
+};
@@ -1,11 +1,16 @@
 #pragma once
+#include "../utility/DistanceFieldCache.h"
+#include "../utility/GridDistances.h"
+#include "../utility/GridMap.h"
 #include "../utility/PairHash.h"
 #include "../utility/SlidingWindow.h"
+#include "../utility/StateMap.h"
 #include "../utility/debug.h"
 #include <algorithm>
 #include <bitset>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
@@ -72,13 +77,14 @@ public:
             return theKey != state.key();
         }
 
+        // x and y side by side, so no two cells share a key (the string
+        // combine this replaced did: 1,11 and 11,1)
+        static constexpr bool perfectKey = true;
+
         void generateKey()
         {
-            // This will provide a unique hash for every state in the
-            // vaccumworld, the normal hash_combine seems go out of the search
-            // space for 200x200, so we use the slower string combine here
-            string sKey = to_string(x) + to_string(y);
-            theKey      = std::hash<string>{}(sKey);
+            theKey = static_cast<unsigned long long>(x) << 32 |
+                     static_cast<unsigned long long>(y);
         }
 
         unsigned long long key() const { return theKey; }
@@ -100,7 +106,7 @@ public:
 
     private:
         size_t             x, y;
-        char               label;
+        char               label = 0;
         Action             fromAction;
         unsigned long long theKey =
           std::numeric_limits<unsigned long long>::max();
@@ -120,7 +126,30 @@ public:
         initialize();
     }
 
-    void setVariant(int variant) { heuristicVariant = variant; }
+    // load a binary map written by mapConverter, the file is mmapped
+    GridPathfindingWithTarPit(const string& binaryMapFile)
+    {
+        if (!gridMap.open(binaryMapFile)) {
+            cerr << "can not open binary map: " << binaryMapFile << "\n";
+            exit(1);
+        }
+        loadMapInfo();
+        initilaizeActions();
+        heuristicVariant = 0; // Default
+        initialize();
+    }
+
+    // dump the parsed instance in the binary map format
+    void writeBinaryMap(ostream& out) const { gridMap.write(out); }
+
+    // 0: euclidean, 1: manhattan, 2: true distance (backward dijkstra)
+    void setVariant(int variant)
+    {
+        heuristicVariant = variant;
+        if (heuristicVariant == 2) {
+            loadGoalDistanceField();
+        }
+    }
 
     // void setVariant(int variant) { costVariant = variant; }
 
@@ -176,9 +205,51 @@ public:
         if (heuristicVariant == 1) {
             return manhattanDistanceToGoal(state);
         }
+        if (heuristicVariant == 2) {
+            return gridMap.layer(GridMap::DIJKSTRA, state.getX(),
+                                 state.getY());
+        }
         return euclideanDistToGoal(state);
     }
 
+    // heuristic(), distance() and distanceErr() of each of the states, with
+    // the heuristic function computed for all of them in one pass
+    void evaluate(const vector<State>& states, vector<Cost>& h, vector<Cost>& d,
+                  vector<Cost>& derr)
+    {
+        size_t n = states.size();
+        batchX.resize(n);
+        batchY.resize(n);
+        batchH.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            batchX[i] = static_cast<int32_t>(states[i].getX());
+            batchY[i] = static_cast<int32_t>(states[i].getY());
+        }
+
+        auto gx = static_cast<int32_t>(goalX);
+        auto gy = static_cast<int32_t>(goalY);
+        if (heuristicVariant == 1) {
+            GridDistances::manhattan(batchX.data(), batchY.data(), n, gx, gy,
+                                     batchH.data());
+        } else if (heuristicVariant == 2) {
+            GridDistances::gather(gridMap.layerData(GridMap::DIJKSTRA),
+                                  mapWidth, batchX.data(), batchY.data(), n,
+                                  batchH.data());
+        } else {
+            GridDistances::euclidean(batchX.data(), batchY.data(), n, gx, gy,
+                                     batchH.data());
+        }
+
+        h.resize(n);
+        d.resize(n);
+        derr.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            h[i]    = learned(correctedH, states[i], batchH[i]);
+            d[i]    = learned(correctedD, states[i], batchH[i]);
+            derr[i] = learned(correctedDerr, states[i], batchH[i]);
+        }
+    }
+
     void updateDistance(const State& state, Cost value)
     {
         correctedD[state] = value;
@@ -200,9 +271,8 @@ public:
     {
         return x >= 0 && y >= 0 && static_cast<size_t>(x) < mapWidth &&
                static_cast<size_t>(y) < mapHeight &&
-               blockedCells.find(
-                 Location(static_cast<size_t>(x), static_cast<size_t>(y))) ==
-                 blockedCells.end();
+               !gridMap.isBlocked(static_cast<size_t>(x),
+                                  static_cast<size_t>(y));
     }
 
     std::vector<State> successors(const State& state)
@@ -252,6 +322,14 @@ public:
         return 1;
     }
 
+    // whether every edge cost and heuristic value is a whole number, so a
+    // BucketQueue can keep open
+    bool hasIntegralCosts() const
+    {
+        return (heuristicVariant == 1 || heuristicVariant == 2) &&
+               tarPitCost == floor(tarPitCost);
+    }
+
     string getDomainInformation() const
     {
         string info = "{ \"Domain\": \"grid pathfinding\", \"widthxheight\": " +
@@ -270,6 +348,10 @@ public:
 
         averageExpansionDelay     = 0;
         averageExpansionDelayCntr = 0;
+
+        curEpsilonH      = 0;
+        curEpsilonD      = 0;
+        expansionCounter = 0;
     }
 
     void pushDelayWindow(unsigned int val)
@@ -293,8 +375,8 @@ public:
 
     string getSubDomainName() const { return ""; }
 
-    Cost getGlobalEpsilonH() const { return curEpsilonH; }
-    Cost getGlobalEpsilonD() const { return curEpsilonD; }
+    double getGlobalEpsilonH() const { return curEpsilonH; }
+    double getGlobalEpsilonD() const { return curEpsilonD; }
 
     void pushGlobalEpsilons(double epsH_, double epsD_)
     {
@@ -330,6 +412,8 @@ private:
         stringstream ss2(line);
         ss2 >> mapHeight;
 
+        gridMap.resize(mapWidth, mapHeight);
+
         for (size_t y = 0; y < mapHeight; y++) {
 
             getline(input, line);
@@ -341,17 +425,16 @@ private:
 
                 switch (cell) {
                     case '#':
-                        blockedCells.insert(Location(x, y));
+                        gridMap.set(GridMap::BLOCKED, x, y);
                         break;
                     case '$':
-                        tarPitCells.insert(Location(x, y));
+                        gridMap.set(GridMap::TARPIT, x, y);
                         break;
                     case '*':
-                        goalX = x;
-                        goalY = y;
+                        gridMap.setGoal(Location(x, y));
                         break;
                     case '@':
-                        startLocation = Location(x, y);
+                        gridMap.setStart(Location(x, y));
                         break;
                 }
             }
@@ -360,11 +443,25 @@ private:
         getline(input, line); // skip the solution
         getline(input, line);
         stringstream ss4(line);
-        ss4 >> tarPitCost;
+        double       cost;
+        ss4 >> cost;
+        gridMap.setTarPitCost(cost);
+
+        loadMapInfo();
+    }
+
+    void loadMapInfo()
+    {
+        mapWidth      = gridMap.getWidth();
+        mapHeight     = gridMap.getHeight();
+        startLocation = gridMap.getStart();
+        goalX         = gridMap.getGoal().first;
+        goalY         = gridMap.getGoal().second;
+        tarPitCost    = gridMap.getTarPitCost();
 
         cout << "size: " << mapWidth << "x" << mapHeight << "\n";
-        cout << "blocked: " << blockedCells.size() << "\n";
-        cout << "tarPit: " << tarPitCells.size() << "\n";
+        cout << "blocked: " << gridMap.count(GridMap::BLOCKED) << "\n";
+        cout << "tarPit: " << gridMap.count(GridMap::TARPIT) << "\n";
         cout << "tarPit Cost: " << tarPitCost << "\n";
         cout << "goalX: " << goalX << "goalY: " << goalY << "\n";
         cout << "startX: " << startLocation.first
@@ -374,6 +471,79 @@ private:
           State(startLocation.first, startLocation.second, Action{999, 999});
     }
 
+    void loadGoalDistanceField()
+    {
+        if (gridMap.hasLayer(GridMap::DIJKSTRA)) {
+            return;
+        }
+
+        if (DistanceFieldCache::enabled()) {
+            auto f = DistanceFieldCache::get(
+              gridMap.contentHash(),
+              "grid-truedist-" + to_string(goalX) + "_" + to_string(goalY) +
+          "-" + to_string(tarPitCost),
+              mapWidth * mapHeight,
+              [this](vector<double>& field) { goalDistanceField(field); });
+            if (f) {
+                gridMap.attachLayer(GridMap::DIJKSTRA, f,
+                                    DistanceFieldCache::dataOffset());
+                return;
+            }
+        }
+
+        vector<double> field(mapWidth * mapHeight);
+        goalDistanceField(field);
+        gridMap.assignLayer(GridMap::DIJKSTRA, std::move(field));
+    }
+
+    // exact cost-to-go of every cell, backward dijkstra from the goal
+    void goalDistanceField(vector<double>& field) const
+    {
+        using Entry = pair<double, size_t>;
+
+        field.assign(mapWidth * mapHeight,
+                     numeric_limits<double>::infinity());
+
+        priority_queue<Entry, vector<Entry>, greater<Entry>> open;
+        field[goalY * mapWidth + goalX] = 0;
+        open.push(Entry(0, goalY * mapWidth + goalX));
+
+        while (!open.empty()) {
+            auto cur = open.top();
+            open.pop();
+
+            if (cur.first > field[cur.second]) {
+                continue;
+            }
+
+            size_t x = cur.second % mapWidth;
+            size_t y = cur.second / mapWidth;
+
+            // every predecessor is one move away from this cell
+            for (auto action : actions) {
+                int predX = static_cast<int>(x) - action.moveX;
+                int predY = static_cast<int>(y) - action.moveY;
+
+                if (!isLegalLocation(predX, predY)) {
+                    continue;
+                }
+
+                auto px = static_cast<size_t>(predX);
+                auto py = static_cast<size_t>(predY);
+
+                double cost = 1;
+                if (gridMap.isTarPit(px, py) && !gridMap.isTarPit(x, y)) {
+                    cost = tarPitCost;
+                }
+
+                if (cur.first + cost < field[py * mapWidth + px]) {
+                    field[py * mapWidth + px] = cur.first + cost;
+                    open.push(Entry(cur.first + cost, py * mapWidth + px));
+                }
+            }
+        }
+    }
+
     void initilaizeActions()
     {
         // move left, right, up, down
@@ -395,6 +565,18 @@ private:
 
     size_t abs_diff(size_t a, size_t b) const { return a > b ? a - b : b - a; }
 
+    // the value learnt for the state, or `value` from now on if there is none
+    static Cost learned(StateMap<State, Cost, HashState>& table,
+                        const State& state, Cost value)
+    {
+        auto it = table.find(state);
+        if (it != table.end()) {
+            return it->second;
+        }
+        table[state] = value;
+        return value;
+    }
+
     Location getParentLocation(const State& state) const
     {
         return Location(
@@ -404,7 +586,7 @@ private:
 
     bool isTarPit(const Location& loc) const
     {
-        return tarPitCells.find(loc) != tarPitCells.end();
+        return gridMap.isTarPit(loc.first, loc.second);
     }
 
     void incExpansionCounter() { ++expansionCounter; }
@@ -434,8 +616,7 @@ private:
         curEpsilonD += eps / expansionCounter;
     }
 
-    std::unordered_set<Location, pair_hash> blockedCells;
-    std::unordered_set<Location, pair_hash> tarPitCells;
+    GridMap                                 gridMap;
     double                                  tarPitCost;
     vector<Action>                          actions;
     vector<vector<size_t>>                  dijkstraMap;
@@ -446,11 +627,15 @@ private:
 
     double                                         averageExpansionDelay;
     unsigned int                                   averageExpansionDelayCntr;
-    unordered_map<State, Cost, HashState>          correctedH;
-    unordered_map<State, Cost, HashState>          correctedD;
-    unordered_map<State, Cost, HashState>          correctedDerr;
-    unordered_map<State, vector<State>, HashState> predecessorsTable;
+    StateMap<State, Cost, HashState>               correctedH;
+    StateMap<State, Cost, HashState>               correctedD;
+    StateMap<State, Cost, HashState>               correctedDerr;
+    StateMap<State, vector<State>, HashState>      predecessorsTable;
     int                                            heuristicVariant;
+    // scratch for evaluate()
+    vector<int32_t> batchX;
+    vector<int32_t> batchY;
+    vector<double>  batchH;
 
     size_t goalX;
     size_t goalY;
@@ -8,6 +8,8 @@ public:
 
     Cost getEdgeCost(State state) { return state.getFace(); }
 
+    Cost faceCost(int face) const { return face; }
+
     Cost heuristic(const State& state)
     {
         // Check if the heuristic of this state has been updated
@@ -34,9 +36,9 @@ public:
                 }
 
                 manhattanSum +=
-                  static_cast<double>(value) *
-                  (fabs(value / static_cast<int>(size) - static_cast<int>(r)) +
-                   fabs(value % static_cast<int>(size) - static_cast<int>(c)));
+                  value *
+                  (abs(value / static_cast<int>(size) - static_cast<int>(r)) +
+                   abs(value % static_cast<int>(size) - static_cast<int>(c)));
                 // cout << "value " << value << " sum " << manhattanSum << endl;
             }
         }
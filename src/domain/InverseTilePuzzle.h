@@ -3,16 +3,20 @@
 #include <algorithm>
 #include <random>
 
-class InverseTilePuzzle : public SlidingTilePuzzle {
+class InverseTilePuzzle : public BasicSlidingTilePuzzle<double> {
 
 public:
-    using SlidingTilePuzzle::SlidingTilePuzzle;
+    using BasicSlidingTilePuzzle::BasicSlidingTilePuzzle;
 
     Cost getEdgeCost(State state)
     {
         return 1.0 / static_cast<double>(state.getFace());
     }
 
+    Cost faceCost(int face) const { return 1.0 / static_cast<double>(face); }
+
+    bool hasIntegralCosts() const { return false; }
+
     Cost heuristic(const State& state) {
         // Check if the heuristic of this state has been updated
         if (correctedH.find(state) != correctedH.end()) {
@@ -1,8 +1,13 @@
 #pragma once
+#include "../utility/CostTraits.h"
 #include "../utility/SlidingWindow.h"
+#include "../utility/StateMap.h"
 #include <algorithm>
+#include <array>
 #include <bitset>
+#include <cstdint>
 #include <fstream>
+#include <iostream>
 #include <iomanip>
 #include <limits>
 #include <ostream>
@@ -19,22 +24,75 @@ using namespace std;
 class PancakePuzzle
 {
 public:
-    typedef double        Cost;
+    // flips cost whole numbers in every variant, see CostTraits
+    typedef int32_t       Cost;
     static constexpr Cost COST_MAX = std::numeric_limits<Cost>::max();
 
+    // largest stack a State can hold inline
+    static constexpr size_t MAX_PANCAKES = 64;
+
+    // A stack of pancakes stored inline, so copying a State (done for every
+    // successor, node and table lookup) never touches the heap.
+    class Ordering
+    {
+    public:
+        Ordering()
+            : cakes{}
+            , count(0)
+        {}
+
+        explicit Ordering(size_t n)
+            : cakes{}
+            , count(static_cast<unsigned char>(n))
+        {
+            if (n > MAX_PANCAKES) {
+                cerr << "Max pancake size is " << MAX_PANCAKES << "\n";
+                exit(1);
+            }
+        }
+
+        size_t size() const { return count; }
+
+        unsigned char& operator[](size_t i) { return cakes[i]; }
+        unsigned char  operator[](size_t i) const { return cakes[i]; }
+
+        // flip the top of the stack, pancakes 0 through loc
+        void flip(size_t loc)
+        {
+            std::reverse(cakes.data(), cakes.data() + loc + 1);
+        }
+
+        bool operator==(const Ordering& o) const
+        {
+            return count == o.count && std::equal(cakes.data(),
+                                                  cakes.data() + count,
+                                                  o.cakes.data());
+        }
+
+        bool operator!=(const Ordering& o) const { return !(*this == o); }
+
+    private:
+        std::array<unsigned char, MAX_PANCAKES> cakes;
+        unsigned char                           count;
+    };
+
     class State
     {
     public:
         State() {}
 
-        State(std::vector<unsigned int> b, size_t l)
+        State(const Ordering& b, size_t l, size_t gaps_)
             : ordering(b)
             , label(l)
+            , gaps(gaps_)
         {
             generateKey();
         }
 
-        std::vector<unsigned int> getOrdering() const { return ordering; }
+        const Ordering& getOrdering() const { return ordering; }
+
+        // weighted gap count of the stack, kept by the domain as it flips
+        size_t getGaps() const { return gaps; }
 
         friend std::ostream& operator<<(std::ostream&               stream,
                                         const PancakePuzzle::State& state)
@@ -46,15 +104,15 @@ public:
             return stream;
         }
 
+        // the key hashes the stack, so equal keys still compare stacks
+        static constexpr bool perfectKey = false;
+
         bool operator==(const State& state) const
         {
-            return ordering == state.getOrdering();
+            return theKey == state.theKey && ordering == state.ordering;
         }
 
-        bool operator!=(const State& state) const
-        {
-            return ordering != state.getOrdering();
-        }
+        bool operator!=(const State& state) const { return !(*this == state); }
 
         void generateKey()
         {
@@ -94,7 +152,7 @@ public:
             f << "starting positions for pancake :\n";
 
             for (size_t r = 0; r < ordering.size(); r++) {
-                f << ordering[r] << "\n";
+                f << static_cast<int>(ordering[r]) << "\n";
             }
 
             f << "end positions pancake:\n";
@@ -105,9 +163,10 @@ public:
         }
 
     private:
-        std::vector<unsigned int> ordering;
-        size_t                    label;
-        unsigned long long        theKey =
+        Ordering           ordering;
+        size_t             label = 0;
+        size_t             gaps  = 0;
+        unsigned long long theKey =
           std::numeric_limits<unsigned long long>::max();
     };
 
@@ -126,26 +185,25 @@ public:
 
         // Skip the next line
         getline(input, line);
-        std::vector<unsigned int> rows(size, 0);
-
-        startOrdering = rows;
-        endOrdering   = rows;
+        startOrdering = Ordering(size);
+        endOrdering   = Ordering(size);
 
         for (size_t i = 0; i < size; ++i) {
             getline(input, line);
-            startOrdering[i] = static_cast<unsigned int>(stoi(line));
+            startOrdering[i] = static_cast<unsigned char>(stoi(line));
         }
         // Skip the next line
         getline(input, line);
 
         for (size_t i = 0; i < size; ++i) {
             getline(input, line);
-            endOrdering[i] = static_cast<unsigned int>(stoi(line));
+            endOrdering[i] = static_cast<unsigned char>(stoi(line));
         }
 
         puzzleVariant    = 0; // Default
         heuristicVariant = 0; // Default
-        startState       = State(startOrdering, 0);
+        gapModifier      = 0; // Default
+        resetStartState();
 
         initialize();
     }
@@ -188,9 +246,22 @@ public:
     }
     */
 
-    void setPuzzleVariant(int variant) { puzzleVariant = variant; }
-    void setHeuristicVariant(int variant) { heuristicVariant = variant; }
-    void setGapModifier(size_t mod) { gapModifier = mod; }
+    // the variants weight the gaps, so the start state is recounted
+    void setPuzzleVariant(int variant)
+    {
+        puzzleVariant = variant;
+        resetStartState();
+    }
+    void setHeuristicVariant(int variant)
+    {
+        heuristicVariant = variant;
+        resetStartState();
+    }
+    void setGapModifier(size_t mod)
+    {
+        gapModifier = mod;
+        resetStartState();
+    }
 
     bool isGoal(const State& s) const
     {
@@ -201,93 +272,94 @@ public:
         return false;
     }
 
-    Cost gapHeuristic(const State& state) const
+    // Using gap heuristic from - Landmark Heuristics for the Pancake
+    // Problem Where add 1 to heuristic if the adjacent sizes of the
+    // pancakes differs more than 1 For heavy pancake problems. For each gap
+    // b/w x and y, add min(x,y) to heuristic instead of just 1
+    // two heuristic variants:
+    // 0: subtract gapModifier
+    // 1: ignore gapModifier states
+    size_t gapWeight(size_t x, size_t y) const
     {
-        // Using gap heuristic from - Landmark Heuristics for the Pancake
-        // Problem Where add 1 to heuristic if the adjacent sizes of the
-        // pancakes differs more than 1 For heavy pancake problems. For each gap
-        // b/w x and y, add min(x,y) to heuristic instead of just 1
-        // two heuristic variants:
-        // 0: subtract gapModifier
-        // 1: ignore gapModifier states
-        size_t size_ = state.getOrdering().size();
-        size_t plate = size_ + 1;
-        size_t sum   = 0;
         size_t statesIgnored = 0;
         if (heuristicVariant == 1) {
             statesIgnored = gapModifier;
         }
 
-        for (size_t i = 1; i < size; ++i) {
-            size_t x   = state.getOrdering()[i - 1];
-            size_t y   = state.getOrdering()[i];
-            if (x < statesIgnored || y < statesIgnored)
-              continue;
-            int dif = static_cast<int>(x) - static_cast<int>(y);
-            if (dif > 1 || dif < -1) {
-                if (puzzleVariant == 0) {
-                    ++sum;
-                } else {
-                    sum += min(x, y);
-                }
+        if (x < statesIgnored || y < statesIgnored) {
+            return 0;
+        }
+
+        int dif = static_cast<int>(x) - static_cast<int>(y);
+        if (dif > 1 || dif < -1) {
+            if (puzzleVariant == 0) {
+                return 1;
             }
+            return min(x, y);
         }
+        return 0;
+    }
+
+    // the pancake below position i, the plate is size + 1
+    size_t below(const Ordering& ordering, size_t i) const
+    {
+        return i + 1 < size ? ordering[i + 1] : size + 1;
+    }
 
-        size_t x   = state.getOrdering()[size - 1];
-        if (!(x < statesIgnored || plate < statesIgnored)){
-          int dif = static_cast<int>(x) - static_cast<int>(plate);
-          if (dif > 1 || dif < -1) {
-              if (puzzleVariant == 0) {
-                  ++sum;
-              } else {
-                  sum += x;
-              }
-          }
+    size_t countGaps(const Ordering& ordering) const
+    {
+        size_t sum = 0;
+        for (size_t i = 0; i < size; ++i) {
+            sum += gapWeight(ordering[i], below(ordering, i));
         }
+        return sum;
+    }
+
+    Cost gapHeuristic(const State& state) const
+    {
+        return gapHeuristic(state.getGaps());
+    }
+
+    Cost gapHeuristic(size_t gaps) const
+    {
+        auto sum = static_cast<Cost>(gaps);
 
         if (heuristicVariant == 0) {
-            return max(0.0, static_cast<double>(sum) - static_cast<double>(gapModifier));
+            return max(Cost(0), sum - static_cast<Cost>(gapModifier));
         }
-        return static_cast<double>(sum);
+        return sum;
     }
 
-    Cost distance(const State& state)
+    // The learned tables only hold states whose values were updated, every
+    // other state answers with the gap heuristic its state carries.
+    Cost distance(const State& state) const
     {
-        // Check if the distance of this state has been updated
-        if (correctedD.find(state) != correctedD.end()) {
-            return correctedD[state];
+        auto it = correctedD.find(state);
+        if (it != correctedD.end()) {
+            return it->second;
         }
 
-        Cost d = gapHeuristic(state);
-        updateDistance(state, d);
-
-        return correctedD[state];
+        return gapHeuristic(state);
     }
 
-    Cost distanceErr(const State& state)
+    Cost distanceErr(const State& state) const
     {
-        // Check if the distance error of this state has been updated
-        if (correctedDerr.find(state) != correctedDerr.end()) {
-            return correctedDerr[state];
+        auto it = correctedDerr.find(state);
+        if (it != correctedDerr.end()) {
+            return it->second;
         }
 
-        Cost derr = gapHeuristic(state);
-        updateDistanceErr(state, derr);
-
-        return correctedDerr[state];
+        return gapHeuristic(state);
     }
 
-    Cost heuristic(const State& state)
+    Cost heuristic(const State& state) const
     {
-        // Check if the heuristic of this state has been updated
-        if (correctedH.find(state) != correctedH.end()) {
-            return correctedH[state];
+        auto it = correctedH.find(state);
+        if (it != correctedH.end()) {
+            return it->second;
         }
 
-        Cost h = gapHeuristic(state);
-        updateHeuristic(state, h);
-
-        return correctedH[state];
+        return gapHeuristic(state);
     }
 
     void updateDistance(const State& state, Cost value)
@@ -310,28 +382,67 @@ public:
         return static_cast<double>(size) - 1; //  I think this is right
     }
 
-    void flipOrdering(std::vector<State>&       succs,
-                      std::vector<unsigned int> ordering, int loc) const
+    // A flip of pancakes 0 through l only changes the pair at l and the
+    // pancake below it, so the child's gaps are the parent's plus a delta.
+    size_t gapsAfterFlip(const State& state, size_t l) const
     {
-        int start = 0;
-        int end   = loc;
-        while (start < end) {
-            std::swap(ordering[static_cast<size_t>(start++)],
-                      ordering[static_cast<size_t>(end--)]);
-        }
+        const Ordering& ordering = state.getOrdering();
+        size_t          under    = below(ordering, l);
+        return state.getGaps() - gapWeight(ordering[l], under) +
+               gapWeight(ordering[0], under);
+    }
+
+    void flipOrdering(std::vector<State>& succs, const State& state,
+                      int loc) const
+    {
+        auto     l        = static_cast<size_t>(loc);
+        Ordering ordering = state.getOrdering();
+        size_t   gaps     = gapsAfterFlip(state, l);
 
-        succs.push_back(State(ordering, static_cast<size_t>(loc)));
+        ordering.flip(l);
+
+        succs.push_back(State(ordering, l, gaps));
     }
 
     std::vector<State> successors(const State& state) const
     {
         std::vector<State> successors;
+        successors.reserve(size);
         for (int i = static_cast<int>(size) - 1; i > 0; --i) {
             // Don't allow inverse actions, to cut down on branching factor
             if (state.getLabel() == static_cast<size_t>(i))
                 continue;
 
-            flipOrdering(successors, state.getOrdering(), i);
+            flipOrdering(successors, state, i);
+        }
+        return successors;
+    }
+
+    // The operator table of partial expansion (see PartialExpansionAStar):
+    // the successors whose flip cost plus gap heuristic lies in
+    // (above, upTo], in the order of successors(). Both are known from the
+    // parent before flipping, so the other children are never made; `next`
+    // is set to the least value over upTo, infinity if there is none.
+    std::vector<State> successors(const State& state, Cost above, Cost upTo,
+                                  Cost& next) const
+    {
+        std::vector<State> successors;
+        next = CostTraits<Cost>::infinity();
+        for (int i = static_cast<int>(size) - 1; i > 0; --i) {
+            auto l = static_cast<size_t>(i);
+            if (state.getLabel() == l)
+                continue;
+
+            Cost value = flipCost(state.getOrdering(), l) +
+                         gapHeuristic(gapsAfterFlip(state, l));
+            if (value <= above)
+                continue;
+
+            if (value <= upTo) {
+                flipOrdering(successors, state, i);
+            } else {
+                next = min(next, value);
+            }
         }
         return successors;
     }
@@ -339,8 +450,9 @@ public:
     std::vector<State> predecessors(const State& state) const
     {
         std::vector<State> predecessors;
+        predecessors.reserve(size);
         for (int i = static_cast<int>(size) - 1; i > 0; --i) {
-            flipOrdering(predecessors, state.getOrdering(), i);
+            flipOrdering(predecessors, state, i);
         }
         return predecessors;
     }
@@ -349,26 +461,30 @@ public:
 
     const State getStartState() const { return startState; }
 
-    Cost getEdgeCost(State state)
+    Cost getEdgeCost(const State& state)
     {
         // Looking at Andew's code, it looks like this is called
         // mostly on successors being generated. So the label
         // will tell which index the parent chose to flip at.
+        return flipCost(state.getOrdering(), state.getLabel());
+    }
 
+    // The cost of flipping pancakes 0 through l, the same read from the
+    // stack before or after the flip.
+    Cost flipCost(const Ordering& ordering, size_t l) const
+    {
         // Variants:
         // 0: Regular pancake puzzle, where each flip cost 1.
         // 1: Cost is max of two elements of each end of the set being flipped.
         // 2: Each pancake has a weight, equal to its index.
         //    The cost is the sum of the indexes of pancakes being flipped.
 
-        size_t l = state.getLabel();
-
         if (puzzleVariant == 1) {
-            size_t i = state.getOrdering()[0];
-            size_t j = state.getOrdering()[l];
+            size_t i = ordering[0];
+            size_t j = ordering[l];
             if (i > j)
-                return static_cast<double>(i);
-            return static_cast<double>(j);
+                return static_cast<Cost>(i);
+            return static_cast<Cost>(j);
         }
 
         if (puzzleVariant == 2) {
@@ -376,13 +492,16 @@ public:
             for (size_t i = 1; i <= l; ++i) {
                 sum += i;
             }
-            return static_cast<double>(sum);
+            return static_cast<Cost>(sum);
         }
 
         // Variant 1
         return 1;
     }
 
+    // flips and gaps are counted in whole pancakes
+    bool hasIntegralCosts() const { return true; }
+
     string getDomainInformation()
     {
         string variant;
@@ -421,6 +540,10 @@ public:
         correctedH.clear();
         averageExpansionDelay     = 0;
         averageExpansionDelayCntr = 0;
+
+        curEpsilonH      = 0;
+        curEpsilonD      = 0;
+        expansionCounter = 0;
     }
 
     void pushDelayWindow(unsigned int val)
@@ -444,16 +567,10 @@ public:
 
     bool validatePath(queue<int> path)
     {
-        std::vector<unsigned int> board = startOrdering;
-
-        std::vector<State> successors;
+        Ordering board = startOrdering;
 
         while (!path.empty()) {
-            size_t start = 0;
-            size_t end   = static_cast<size_t>(path.front());
-            while (start < end) {
-                std::swap(board[start++], board[end--]);
-            }
+            board.flip(static_cast<size_t>(path.front()));
             path.pop();
         }
 
@@ -464,17 +581,62 @@ public:
 
     string getSubDomainName() const { return ""; }
 
-    std::vector<unsigned int> startOrdering;
-    std::vector<unsigned int> endOrdering;
+    void resetStartState()
+    {
+        startState = State(startOrdering, 0, countGaps(startOrdering));
+    }
+
+    double getGlobalEpsilonH() const { return curEpsilonH; }
+    double getGlobalEpsilonD() const { return curEpsilonD; }
+
+    void pushGlobalEpsilons(double epsH_, double epsD_)
+    {
+        incExpansionCounter();
+        pushEpsilonHGlobal(epsH_);
+        pushEpsilonDGlobal(epsD_);
+    }
+
+    void resetStartEpsilons() {}
+
+    void incExpansionCounter() { ++expansionCounter; }
+
+    void pushEpsilonHGlobal(double eps)
+    {
+        if (expansionCounter < 5) {
+            curEpsilonH = 0;
+            return;
+        }
+
+        curEpsilonH -= curEpsilonH / expansionCounter;
+        curEpsilonH += eps / expansionCounter;
+    }
+
+    void pushEpsilonDGlobal(double eps)
+    {
+        if (expansionCounter < 5) {
+            curEpsilonD = 0;
+            return;
+        }
+
+        curEpsilonD -= curEpsilonD / expansionCounter;
+        curEpsilonD += eps / expansionCounter;
+    }
+
+    Ordering startOrdering;
+    Ordering endOrdering;
 
     State                                 startState;
     double                                averageExpansionDelay;
     unsigned int                          averageExpansionDelayCntr;
-    unordered_map<State, Cost, HashState> correctedH;
-    unordered_map<State, Cost, HashState> correctedD;
-    unordered_map<State, Cost, HashState> correctedDerr;
+    StateMap<State, Cost, HashState>      correctedH;
+    StateMap<State, Cost, HashState>      correctedD;
+    StateMap<State, Cost, HashState>      correctedDerr;
     int                                   puzzleVariant;
     int                                   heuristicVariant;
     size_t                                gapModifier;
     size_t                                size;
+
+    double       curEpsilonH;
+    double       curEpsilonD;
+    unsigned int expansionCounter;
 };
@@ -1,10 +1,14 @@
 #pragma once
+#include "../utility/DistanceFieldCache.h"
+#include "../utility/GridMap.h"
 #include "../utility/PairHash.h"
 #include "../utility/SlidingWindow.h"
+#include "../utility/StateMap.h"
 #include "../utility/debug.h"
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
@@ -62,16 +66,14 @@ public:
             return theKey != state.key();
         }
 
+        // x, y, dx and dy in 16 bits each, which tells every state apart
+        // on the maps loadMapInfo accepts
+        static constexpr bool perfectKey = true;
+
         void generateKey()
         {
-            // This will provide a unique hash for every state in the racetrack,
-            unsigned long long val        = 0xCBF29CE484222325;
-            unsigned int       x_unsigned = static_cast<unsigned int>(x);
-
-            val = val ^ x_unsigned ^ (static_cast<size_t>(dx) << 8) ^
-                  (static_cast<size_t>(y) << 16) ^
-                  (static_cast<size_t>(dy) << 24);
-            theKey = val;
+            theKey = field(x) | field(y) << 16 | field(dx) << 32 |
+                     field(dy) << 48;
         }
 
         unsigned long long key() const { return theKey; }
@@ -101,8 +103,13 @@ public:
         void markStart() { label = 's'; }
 
     private:
+        static unsigned long long field(int v)
+        {
+            return static_cast<uint16_t>(v);
+        }
+
         int                x, y, dx, dy;
-        char               label;
+        char               label = 0;
         unsigned long long theKey =
           std::numeric_limits<unsigned long long>::max();
     };
@@ -128,12 +135,44 @@ public:
         initialize();
     }
 
+    // map only, the start state is the '@' cell of the map
+    RaceTrack(std::istream& raceMap)
+    {
+        parseMap(raceMap);
+        initilaizeActions();
+        computeDijkstraMap();
+        computeEuclideanMap();
+        heuristicVariant = 0; // Default
+        initialize();
+    }
+
+    // load a binary map written by mapConverter, the file is mmapped and
+    // already carries the dijkstra and euclidean maps
+    RaceTrack(const string& binaryMapFile, std::istream& initialState)
+    {
+        if (!gridMap.open(binaryMapFile) ||
+            !gridMap.hasLayer(GridMap::DIJKSTRA) ||
+            !gridMap.hasLayer(GridMap::EUCLIDEAN)) {
+            cerr << "can not open binary racetrack map: " << binaryMapFile
+                 << "\n";
+            exit(1);
+        }
+        loadMapInfo();
+        resetInitialState(initialState);
+        initilaizeActions();
+        heuristicVariant = 0; // Default
+        initialize();
+    }
+
+    // dump the parsed map in the binary map format
+    void writeBinaryMap(ostream& out) const { gridMap.write(out); }
+
     void setVariant(int variant) { heuristicVariant = variant; }
 
     bool isGoal(const State& s) const
     {
-        Location loc = Location(s.getX(), s.getY());
-        return finishline.find(loc) != finishline.end();
+        return gridMap.isGoal(static_cast<size_t>(s.getX()),
+                              static_cast<size_t>(s.getY()));
     }
 
     Cost distance(const State& state)
@@ -214,12 +253,14 @@ public:
     {
         // cout << state;
         if (heuristicVariant == 1) {
-            return static_cast<double>(euclideanMap[static_cast<size_t>(
-                     state.getX())][static_cast<size_t>(state.getY())]) /
+            return gridMap.layer(GridMap::EUCLIDEAN,
+                                 static_cast<size_t>(state.getX()),
+                                 static_cast<size_t>(state.getY())) /
                    maxSpeed;
         }
-        return static_cast<double>(dijkstraMap[static_cast<size_t>(
-                 state.getX())][static_cast<size_t>(state.getY())]) /
+        return gridMap.layer(GridMap::DIJKSTRA,
+                             static_cast<size_t>(state.getX()),
+                             static_cast<size_t>(state.getY())) /
                maxSpeed;
     }
 
@@ -229,9 +270,8 @@ public:
     {
         return x >= 0 && y >= 0 && static_cast<size_t>(x) < mapWidth &&
                static_cast<size_t>(y) < mapHeight &&
-               blockedCells.find(
-                 Location(static_cast<size_t>(x), static_cast<size_t>(y))) ==
-                 blockedCells.end();
+               !gridMap.isBlocked(static_cast<size_t>(x),
+                                  static_cast<size_t>(y));
     }
 
     bool isCollisionFree(int x, int y, int dx, int dy,
@@ -328,6 +368,9 @@ public:
 
     Cost getEdgeCost(State) { return 1; }
 
+    // the heuristics are divided by the top speed
+    bool hasIntegralCosts() const { return false; }
+
     string getDomainInformation()
     {
         string info = "{ \"Domain\": \"race track\", \"widthxheight\": " +
@@ -345,6 +388,10 @@ public:
         correctedDerr.clear();
         averageExpansionDelay     = 0;
         averageExpansionDelayCntr = 0;
+
+        curEpsilonH      = 0;
+        curEpsilonD      = 0;
+        expansionCounter = 0;
     }
 
     void pushDelayWindow(unsigned int val)
@@ -368,8 +415,44 @@ public:
 
     string getSubDomainName() const { return ""; }
 
+    double getGlobalEpsilonH() const { return curEpsilonH; }
+    double getGlobalEpsilonD() const { return curEpsilonD; }
+
+    void pushGlobalEpsilons(double epsH_, double epsD_)
+    {
+        incExpansionCounter();
+        pushEpsilonHGlobal(epsH_);
+        pushEpsilonDGlobal(epsD_);
+    }
+
+    void resetStartEpsilons() {}
+
 private:
-    void parseMap(std::ifstream& raceMap)
+    void incExpansionCounter() { ++expansionCounter; }
+
+    void pushEpsilonHGlobal(double eps)
+    {
+        if (expansionCounter < 5) {
+            curEpsilonH = 0;
+            return;
+        }
+
+        curEpsilonH -= curEpsilonH / expansionCounter;
+        curEpsilonH += eps / expansionCounter;
+    }
+
+    void pushEpsilonDGlobal(double eps)
+    {
+        if (expansionCounter < 5) {
+            curEpsilonD = 0;
+            return;
+        }
+
+        curEpsilonD -= curEpsilonD / expansionCounter;
+        curEpsilonD += eps / expansionCounter;
+    }
+
+    void parseMap(std::istream& raceMap)
     {
         string line;
         getline(raceMap, line);
@@ -381,6 +464,8 @@ private:
         stringstream ss2(line);
         ss2 >> mapHeight;
 
+        gridMap.resize(mapWidth, mapHeight);
+
         for (size_t y = 0; y < mapHeight; y++) {
 
             getline(raceMap, line);
@@ -392,18 +477,35 @@ private:
 
                 switch (cell) {
                     case '#':
-                        blockedCells.insert(Location(x, y));
+                        gridMap.set(GridMap::BLOCKED, x, y);
                         break;
                     case '*':
-                        finishline.insert(Location(x, y));
+                        gridMap.set(GridMap::GOAL, x, y);
                         break;
                     case '@':
-                        startLocation = Location(x, y);
+                        gridMap.setStart(Location(x, y));
                         break;
                 }
             }
         }
 
+        loadMapInfo();
+    }
+
+    void loadMapInfo()
+    {
+        mapWidth      = gridMap.getWidth();
+        mapHeight     = gridMap.getHeight();
+        startLocation = gridMap.getStart();
+
+        if (mapWidth > numeric_limits<uint16_t>::max() ||
+            mapHeight > numeric_limits<uint16_t>::max()) {
+            cerr << "racetrack map too large (" << mapWidth << "x" << mapHeight
+                 << "), a side can be at most "
+                 << numeric_limits<uint16_t>::max() << "\n";
+            exit(1);
+        }
+
         maxXSpeed = static_cast<double>(mapWidth) / 2;
         maxYSpeed = static_cast<double>(mapHeight) / 2;
         maxSpeed  = max(maxXSpeed, maxYSpeed);
@@ -411,8 +513,8 @@ private:
         startState = State(static_cast<int>(startLocation.first),
                            static_cast<int>(startLocation.second), 0, 0);
         // cout << "size: " << mapWidth << "x" << mapHeight << "\n";
-        // cout << "blocked: " << blockedCells.size() << "\n";
-        // cout << "finish: " << finishline.size() << "\n";
+        // cout << "blocked: " << gridMap.count(GridMap::BLOCKED) << "\n";
+        // cout << "finish: " << gridMap.count(GridMap::GOAL) << "\n";
     }
 
     void initilaizeActions()
@@ -440,14 +542,41 @@ private:
     }
 
     void computeDijkstraMap()
+    {
+        // the map hash covers the finish line, so it is the whole key
+        if (DistanceFieldCache::enabled()) {
+            auto f = DistanceFieldCache::get(
+              gridMap.contentHash(), "racetrack-dijkstra",
+              mapWidth * mapHeight,
+              [this](vector<double>& field) { dijkstraField(field); });
+            if (f) {
+                gridMap.attachLayer(GridMap::DIJKSTRA, f,
+                                    DistanceFieldCache::dataOffset());
+                return;
+            }
+        }
+
+        vector<double> field(mapWidth * mapHeight);
+        dijkstraField(field);
+        gridMap.assignLayer(GridMap::DIJKSTRA, std::move(field));
+    }
+
+    void dijkstraField(vector<double>& field)
     {
         vector<size_t> col(mapHeight, std::numeric_limits<size_t>::max());
-        dijkstraMap = vector<vector<size_t>>(mapWidth, col);
+        vector<vector<size_t>> dijkstraMap(mapWidth, col);
 
-        for (const auto& g : finishline) {
+        for (const auto& g : gridMap.cells(GridMap::GOAL)) {
             dijkstraOneGoal(g, dijkstraMap);
         }
 
+        for (size_t x = 0; x < mapWidth; x++) {
+            for (size_t y = 0; y < mapHeight; y++) {
+                field[y * mapWidth + x] =
+                  static_cast<double>(dijkstraMap[x][y]);
+            }
+        }
+
         // visualize the dijkstra map (for debug usage)
         /*vector<size_t>         rotateCol(mapWidth, INT_MAX);*/
         // vector<vector<size_t>> rotatedMap(mapHeight, rotateCol);
@@ -555,9 +684,9 @@ private:
     void computeEuclideanMap()
     {
         vector<double> col(mapHeight, std::numeric_limits<double>::max());
-        euclideanMap = vector<vector<double>>(mapWidth, col);
+        vector<vector<double>> euclideanMap(mapWidth, col);
 
-        for (const auto& g : finishline) {
+        for (const auto& g : gridMap.cells(GridMap::GOAL)) {
             for (int i = 0; i < static_cast<int>(mapWidth); i++) {
                 for (int j = 0; j < static_cast<int>(mapHeight); j++) {
                     if (!isLegalLocation(i, j)) {
@@ -579,6 +708,13 @@ private:
             }
         }
 
+        gridMap.initLayer(GridMap::EUCLIDEAN, 0);
+        for (size_t x = 0; x < mapWidth; x++) {
+            for (size_t y = 0; y < mapHeight; y++) {
+                gridMap.setLayer(GridMap::EUCLIDEAN, x, y, euclideanMap[x][y]);
+            }
+        }
+
         // visualize the euclidean map (for debug usage)
         /*vector<double> rotateCol(mapWidth, numeric_limits<double>::max());*/
         // vector<vector<double>> rotatedMap(mapHeight, rotateCol);
@@ -599,11 +735,8 @@ private:
         /*}*/
     }
 
-    std::unordered_set<Location, pair_hash>        blockedCells;
-    std::unordered_set<Location, pair_hash>        finishline;
+    GridMap                                        gridMap;
     vector<pair<int, int>>                         actions;
-    vector<vector<size_t>>                         dijkstraMap;
-    vector<vector<double>>                         euclideanMap;
     size_t                                         mapWidth;
     size_t                                         mapHeight;
     double                                         maxXSpeed;
@@ -613,9 +746,13 @@ private:
     State                                          startState;
     double                                         averageExpansionDelay;
     unsigned int                                   averageExpansionDelayCntr;
-    unordered_map<State, Cost, HashState>          correctedH;
-    unordered_map<State, Cost, HashState>          correctedD;
-    unordered_map<State, Cost, HashState>          correctedDerr;
-    unordered_map<State, vector<State>, HashState> predecessorsTable;
+    StateMap<State, Cost, HashState>               correctedH;
+    StateMap<State, Cost, HashState>               correctedD;
+    StateMap<State, Cost, HashState>               correctedDerr;
+    StateMap<State, vector<State>, HashState>      predecessorsTable;
     int                                            heuristicVariant;
+
+    double       curEpsilonH;
+    double       curEpsilonD;
+    unsigned int expansionCounter;
 };
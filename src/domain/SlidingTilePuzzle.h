@@ -1,9 +1,15 @@
 #pragma once
+#include "../utility/CostTraits.h"
+#include "../utility/Random.h"
 #include "../utility/SlidingWindow.h"
+#include "../utility/StateMap.h"
 #include <algorithm>
 #include <bitset>
 #include <cmath>
+#include <cstdint>
+#include <cstdlib>
 #include <iomanip>
+#include <iostream>
 #include <limits>
 #include <ostream>
 #include <queue>
@@ -14,10 +20,14 @@
 
 using namespace std;
 
-class SlidingTilePuzzle
+// The puzzle for a Cost type: the unit and heavy puzzles move at whole
+// costs and use 32-bit integers (SlidingTilePuzzle, HeavyTilePuzzle), the
+// inverse one needs a double (InverseTilePuzzle).
+template<class CostType>
+class BasicSlidingTilePuzzle
 {
 public:
-    typedef double        Cost;
+    typedef CostType      Cost;
     static constexpr Cost COST_MAX = std::numeric_limits<Cost>::max();
 
     class State
@@ -38,8 +48,8 @@ public:
             generateKey(b);
         }
 
-        friend std::ostream& operator<<(std::ostream&                   stream,
-                                        const SlidingTilePuzzle::State& state)
+        friend std::ostream& operator<<(std::ostream& stream,
+                                        const State&  state)
         {
             for (unsigned int r = 0; r < state.getBoard().size(); r++) {
                 for (unsigned int c = 0; c < state.getBoard()[r].size(); c++) {
@@ -50,6 +60,10 @@ public:
             return stream;
         }
 
+        // four bits a tile, perfect up to the 4x4 puzzle the constructor
+        // accepts
+        static constexpr bool perfectKey = true;
+
         bool operator==(const State& state) const
         {
             return theKey == state.key();
@@ -158,7 +172,7 @@ public:
         }
     };
 
-    SlidingTilePuzzle(std::istream& input)
+    BasicSlidingTilePuzzle(std::istream& input)
     {
         // Get the dimensions of the puzzle
         string line;
@@ -166,6 +180,11 @@ public:
         stringstream ss(line);
         // Get the first dimension...
         ss >> size;
+        if (size > 4) {
+            cerr << "tile puzzles are at most 4x4, got " << size << "x"
+                 << size << "\n";
+            exit(1);
+        }
         // We don't give a shit about the second dimension,
         // because every puzzle should be square.
 
@@ -222,10 +241,24 @@ public:
         // If the table of random numbers for the hash function hasn't been
         // filled
         // then it should be filled now...
-        if (SlidingTilePuzzle::table.empty()) {
-            srand(static_cast<unsigned int>(time(NULL)));
+        if (table.empty()) {
+            RandomGenerator rng;
             for (int i = 0; i < 256; i++) {
-                table.push_back(rand());
+                table.push_back(static_cast<int>(rng.next() >> 33));
+            }
+        }
+
+        // how far each tile is from its own square on each square, the
+        // operator table of partial expansion reads it
+        size_t squares = size * size;
+        tileDistances.resize(squares * squares);
+        for (size_t tile = 1; tile < squares; tile++) {
+            for (size_t square = 0; square < squares; square++) {
+                tileDistances[tile * squares + square] =
+                  abs(static_cast<int>(tile / size) -
+                      static_cast<int>(square / size)) +
+                  abs(static_cast<int>(tile % size) -
+                      static_cast<int>(square % size));
             }
         }
 
@@ -233,7 +266,7 @@ public:
         initialize();
     }
 
-    virtual ~SlidingTilePuzzle() {}
+    virtual ~BasicSlidingTilePuzzle() {}
 
     bool isGoal(const State& s) const
     {
@@ -313,8 +346,8 @@ public:
                 }
 
                 manhattanSum +=
-                  fabs(value / static_cast<int>(size) - static_cast<int>(r)) +
-                  fabs(value % static_cast<int>(size) - static_cast<int>(c));
+                  abs(value / static_cast<int>(size) - static_cast<int>(r)) +
+                  abs(value % static_cast<int>(size) - static_cast<int>(c));
                 // cout << value << " sum " << manhattanSum << endl;
             }
         }
@@ -446,6 +479,70 @@ public:
         return successors;
     }
 
+    // The operator table of partial expansion (see PartialExpansionAStar):
+    // the successors whose edge cost plus heuristic lies in (above, upTo],
+    // in the order of successors(). A move slides one tile by one square,
+    // so each child's heuristic is the parent's plus that tile's change of
+    // distance, and only the children in range are made; `next` is set to
+    // the least value over upTo, infinity if there is none.
+    std::vector<State> successors(const State& state, Cost above, Cost upTo,
+                                  Cost& next) const
+    {
+        std::vector<State> successors;
+        next = CostTraits<Cost>::infinity();
+
+        auto   board = state.getBoard();
+        size_t blank = 0;
+        Cost   h     = 0;
+        for (size_t square = 0; square < size * size; square++) {
+            int tile = board[square / size][square % size];
+            if (tile == 0) {
+                blank = square;
+            } else {
+                h += faceCost(tile) *
+                     static_cast<Cost>(tileDistance(tile, square));
+            }
+        }
+
+        typedef void (BasicSlidingTilePuzzle::*Move)(
+          std::vector<State>&, std::vector<std::vector<int>>) const;
+
+        // the tile on `from` slides into the blank
+        auto slide = [&](bool legal, size_t from, Move move) {
+            if (!legal) {
+                return;
+            }
+
+            int  tile  = board[from / size][from % size];
+            Cost cost  = faceCost(tile);
+            Cost value = cost + h +
+                         cost * static_cast<Cost>(tileDistance(tile, blank) -
+                                                  tileDistance(tile, from));
+            if (value <= above) {
+                return;
+            }
+
+            if (value <= upTo) {
+                (this->*move)(successors, board);
+            } else {
+                next = min(next, value);
+            }
+        };
+
+        size_t r = blank / size;
+        size_t c = blank % size;
+        slide(state.getLabel() != 'D' && r > 0, blank - size,
+              &BasicSlidingTilePuzzle::moveUp);
+        slide(state.getLabel() != 'U' && r + 1 < size, blank + size,
+              &BasicSlidingTilePuzzle::moveDown);
+        slide(state.getLabel() != 'R' && c > 0, blank - 1,
+              &BasicSlidingTilePuzzle::moveLeft);
+        slide(state.getLabel() != 'L' && c + 1 < size, blank + 1,
+              &BasicSlidingTilePuzzle::moveRight);
+
+        return successors;
+    }
+
     std::vector<State> predecessors(const State& state) const
     {
         std::vector<State> predecessors;
@@ -464,6 +561,18 @@ public:
 
     virtual Cost getEdgeCost(State) { return 1; }
 
+    // what moving a tile costs, and the weight of its distance in the
+    // heuristic
+    virtual Cost faceCost(int) const { return 1; }
+
+    int tileDistance(int tile, size_t square) const
+    {
+        return tileDistances[static_cast<size_t>(tile) * size * size + square];
+    }
+
+    // unit and heavy tiles move at whole costs, inverse ones do not
+    virtual bool hasIntegralCosts() const { return true; }
+
     string getDomainInformation()
     {
         string info =
@@ -481,6 +590,10 @@ public:
         correctedDerr.clear();
         averageExpansionDelay     = 0;
         averageExpansionDelayCntr = 0;
+
+        curEpsilonH      = 0;
+        curEpsilonD      = 0;
+        expansionCounter = 0;
     }
 
     void pushDelayWindow(unsigned int val)
@@ -533,17 +646,63 @@ public:
 
     virtual string getSubDomainName() const { return "uniform"; }
 
+    double getGlobalEpsilonH() const { return curEpsilonH; }
+    double getGlobalEpsilonD() const { return curEpsilonD; }
+
+    void pushGlobalEpsilons(double epsH_, double epsD_)
+    {
+        incExpansionCounter();
+        pushEpsilonHGlobal(epsH_);
+        pushEpsilonDGlobal(epsD_);
+    }
+
+    void resetStartEpsilons() {}
+
+    void incExpansionCounter() { ++expansionCounter; }
+
+    void pushEpsilonHGlobal(double eps)
+    {
+        if (expansionCounter < 5) {
+            curEpsilonH = 0;
+            return;
+        }
+
+        curEpsilonH -= curEpsilonH / expansionCounter;
+        curEpsilonH += eps / expansionCounter;
+    }
+
+    void pushEpsilonDGlobal(double eps)
+    {
+        if (expansionCounter < 5) {
+            curEpsilonD = 0;
+            return;
+        }
+
+        curEpsilonD -= curEpsilonD / expansionCounter;
+        curEpsilonD += eps / expansionCounter;
+    }
+
     std::vector<std::vector<int>>         startBoard;
     std::vector<std::vector<int>>         endBoard;
     size_t                                size;
     State                                 startState;
     double                                averageExpansionDelay;
     unsigned int                          averageExpansionDelayCntr;
-    unordered_map<State, Cost, HashState> correctedH;
-    unordered_map<State, Cost, HashState> correctedD;
-    unordered_map<State, Cost, HashState> correctedDerr;
+    StateMap<State, Cost, HashState>      correctedH;
+    StateMap<State, Cost, HashState>      correctedD;
+    StateMap<State, Cost, HashState>      correctedDerr;
+
+    double       curEpsilonH;
+    double       curEpsilonD;
+    unsigned int expansionCounter;
+
+    // tileDistance(tile, square), by tile then square
+    vector<int> tileDistances;
 
     static vector<int> table;
 };
 
-vector<int> SlidingTilePuzzle::table;
+template<class CostType>
+vector<int> BasicSlidingTilePuzzle<CostType>::table;
+
+typedef BasicSlidingTilePuzzle<int32_t> SlidingTilePuzzle;
@@ -1,35 +1,67 @@
 #pragma once
+#include "../utility/BucketQueue.h"
+#include "../utility/CostTraits.h"
 #include "../utility/PriorityQueue.h"
 #include "../utility/ResultContainer.h"
+#include "../utility/StateMap.h"
+#include "../utility/TraceSink.h"
 #include "../utility/debug.h"
 #include <functional>
 #include <memory>
-#include <unordered_map>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 using namespace std;
 
-template<class Domain, class Node>
+// the order the lookahead expands open in
+enum class OpenOrder
+{
+    F,   // astar
+    FHAT // fhat
+};
+
+// Whether a domain evaluates a batch of states at once:
+//
+//     void evaluate(const vector<State>& states, vector<Cost>& h,
+//                   vector<Cost>& d, vector<Cost>& derr);
+//
+// giving each state's heuristic(), distance() and distanceErr().
+template<class Domain, class = void>
+struct HasBatchEvaluate : false_type
+{};
+
+template<class Domain>
+struct HasBatchEvaluate<
+  Domain, decltype(void(declval<Domain&>().evaluate(
+            declval<const vector<typename Domain::State>&>(),
+            declval<vector<typename Domain::Cost>&>(),
+            declval<vector<typename Domain::Cost>&>(),
+            declval<vector<typename Domain::Cost>&>())))> : true_type
+{};
+
+template<class Domain, class Node, OpenOrder order>
 class MetaReasonAStar
 {
     typedef typename Domain::State     State;
     typedef typename Domain::Cost      Cost;
     typedef typename Domain::HashState Hash;
+    typedef CostTraits<Cost>           Traits;
 
 public:
-    MetaReasonAStar(Domain& domain_, size_t lookahead_, string sorting_)
+    static constexpr OpenOrder openOrder = order;
+
+    MetaReasonAStar(Domain& domain_, size_t lookahead_)
         : domain(domain_)
         , lookahead(lookahead_)
-        , sortingFunction(sorting_)
+        , expansions(1)
+        , trace(nullptr)
+        , lazy(false)
     {}
 
-    void expand(
-      PriorityQueue<shared_ptr<Node>>&              open,
-      unordered_map<State, shared_ptr<Node>, Hash>& closed,
-      std::function<bool(shared_ptr<Node>,
-                         unordered_map<State, shared_ptr<Node>, Hash>&,
-                         PriorityQueue<shared_ptr<Node>>&)>
-                       duplicateDetection,
-      ResultContainer& res)
+    // begin a new lookahead on open
+    template<class Open>
+    void startLookahead(Open& open)
     {
         // First things first, reorder open so it matches our expansion policy
         // needs
@@ -37,42 +69,47 @@ public:
 
         // This starts at 1, because we had to expand start to get the top level
         // actions
-        size_t expansions = 1;
+        expansions = 1;
 
         // DEBUG_MSG("lookahead=================");
+        if (traceLevel >= TRACE_SINK && trace) {
+            trace->beginGroup(TracePhase::VISITED);
+        }
+    }
+
+    // Expand until the lookahead limit, a goal or an empty open. Once the
+    // lookahead has expanded its first node, stop() is asked before every
+    // expansion; if it says so, return false and pick up from there on the
+    // next call.
+    template<class Open, class DuplicateDetection, class Stop>
+    bool expand(Open&                                         open,
+                StateMap<State, shared_ptr<Node>, Hash>& closed,
+                DuplicateDetection duplicateDetection, ResultContainer& res,
+                Stop&& stop)
+    {
         // Expand until the limit
-        vector<string> visited;
         while (!open.empty() && (expansions < lookahead)) {
+            if (expansions > 1 && stop()) {
+                return false;
+            }
+
             // Pop lowest fhat-value off open
             shared_ptr<Node> cur = open.top();
 
-            string debugStr = "";
-            debugStr += "{state: \'" + cur->getState().toString() + "\',";
-            debugStr += "g: " + my_to_string(cur->getGValue()) + ",";
-            debugStr += "h: " + my_to_string(cur->getHValue()) + ",";
-            debugStr += "f: " + my_to_string(cur->getFValue()) + ",";
-            debugStr +=
-              //"epsH: " + my_to_string(cur->getPathBasedEpsilonH()) + ",";
-              "epsH: " + my_to_string(cur->getEpsilonH()) + ",";
-            debugStr +=
-              //"epsD: " + my_to_string(cur->getPathBasedEpsilonD()) + ",";
-              "epsD: " + my_to_string(cur->getEpsilonD()) + ",";
-            //debugStr +=
-              //"epsCounter: " + to_string(cur->getPathBasedExpansionCounter()) +
-              //",";
-            debugStr += "expansion: " + to_string(expansions) + "}";
-
-            // DEBUG_MSG(debugStr);
-
-            visited.push_back(cur->getState().toString());
-
-            domain.pushDelayWindow(cur->getDelayCntr());
-            // Check if current node is goal
-            if (domain.isGoal(cur->getState())) {
-                DEBUG_MSG("reach goal in expansion");
-                res.solutionFound = true;
-                res.visited.push_back(visited);
-                return;
+            // A deferred node is evaluated on reaching the top, and expanded
+            // only if it is still the best with its own heuristic
+            if (cur->isDeferred()) {
+                evaluate(cur);
+                open.update(cur);
+                if (open.top() != cur) {
+                    continue;
+                }
+                learnOneStepError(cur->getParent()->getState(),
+                                  cur->getState());
+            }
+
+            if (visit(cur, res)) {
+                return true;
             }
 
             res.nodesExpanded++;
@@ -90,71 +127,220 @@ public:
             vector<State> children = domain.successors(cur->getState());
             res.nodesGenerated += children.size();
 
-            shared_ptr<Node>         bestChildNode;
-            Cost                     bestF = numeric_limits<double>::infinity();
-            vector<shared_ptr<Node>> childrenNodes;
-
-            for (State child : children) {
-                shared_ptr<Node> childNode = make_shared<Node>(
-                  cur->getGValue() + domain.getEdgeCost(child),
-                  domain.heuristic(child), domain.distance(child),
-                  domain.distanceErr(child), domain.getGlobalEpsilonH(),
-                  domain.getGlobalEpsilonD(),
-                  0, child, cur);
-
-                bool dup = duplicateDetection(childNode, closed, open);
+            addChildren(cur, children, open, closed, duplicateDetection);
+        }
 
-                if (!dup && childNode->getFValue() < bestF) {
-                    bestF         = childNode->getFValue();
-                    bestChildNode = childNode;
-                }
+        return true;
+    }
 
-                // Duplicate detection
-                if (!dup) {
-                    open.push(childNode);
-                    closed[child] = childNode;
-                    childrenNodes.push_back(childNode);
-                }
-            }
+    // The learning and the decision read the estimates of the whole
+    // frontier, so the nodes the lookahead left deferred are evaluated
+    // before them.
+    template<class Open>
+    void endLookahead(Open&                                    open,
+                      StateMap<State, shared_ptr<Node>, Hash>& closed)
+    {
+        if (!lazy) {
+            return;
+        }
 
-            // Learn path-based one-step error
-            if (bestF != numeric_limits<double>::infinity()) {
-                // Cost epsD = (1 + bestChildNode->getDValue()) -
-                // cur->getDValue();
-                Cost epsD =
-                  (1 + domain.distance(bestChildNode->getState())) -
-                  domain.distance(cur->getState());
-                // DEBUG_MSG("err" + my_to_string(epsD));
-                // DEBUG_MSG("child" + bestChildNode->toString());
-                // DEBUG_MSG("cur" + cur->toString());
-                Cost epsH =
-                  (domain.getEdgeCost(bestChildNode->getState()) +
-                   domain.heuristic(bestChildNode->getState())) -
-                  domain.heuristic(cur->getState());
-
-                /*for (auto child : childrenNodes) {*/
-                    //child->pushPathBasedEpsilons(epsH, epsD);
-                /*}*/
-                domain.pushGlobalEpsilons(epsH, epsD);
+        // closed has the nodes a beam dropped from open too
+        for (const auto& entry : closed) {
+            const shared_ptr<Node>& node = entry.second;
+            if (node->isDeferred()) {
+                evaluate(node);
+                open.update(node);
             }
         }
-
-        res.visited.push_back(visited);
     }
 
     void increaseLookahead(size_t addLookahead) { lookahead += addLookahead; }
 
+    void setTraceSink(TraceSink* trace_) { trace = trace_; }
+
+    // Lazily, a child is queued with its parent's f as a lower bound on its
+    // own (h no less than f(parent) - g) and d, derr one less than the
+    // parent's, and only when it reaches the top of open are the domain's
+    // heuristic, distance and distanceErr asked. A duplicate of an evaluated
+    // state takes its estimates, and one of a deferred state is never
+    // evaluated apart from it. The one-step error is learnt from each
+    // evaluated node that stays on top, rather than from the best child of
+    // each expansion.
+    void setLazyHeuristic(bool lazy_) { lazy = lazy_; }
+
 private:
+    void evaluate(const shared_ptr<Node>& node)
+    {
+        const State& state = node->getState();
+
+        node->setHValue(domain.heuristic(state));
+        node->setDValue(domain.distance(state));
+        node->setDErrValue(domain.distanceErr(state));
+        node->evaluated();
+    }
+
+    // the estimates of each child into childH, childD and childDErr
+    void evaluateChildren(const vector<State>& children, true_type)
+    {
+        domain.evaluate(children, childH, childD, childDErr);
+    }
+
+    void evaluateChildren(const vector<State>& children, false_type)
+    {
+        childH.resize(children.size());
+        childD.resize(children.size());
+        childDErr.resize(children.size());
+        for (size_t i = 0; i < children.size(); ++i) {
+            childH[i]    = domain.heuristic(children[i]);
+            childD[i]    = domain.distance(children[i]);
+            childDErr[i] = domain.distanceErr(children[i]);
+        }
+    }
+
+    // a node generated before for the state has its estimates already
+    shared_ptr<Node> deferredChild(
+      const State& child, Cost g, const shared_ptr<Node>& cur,
+      const StateMap<State, shared_ptr<Node>, Hash>& closed)
+    {
+        auto it = closed.find(child);
+        if (it != closed.end() && !it->second->isDeferred()) {
+            const shared_ptr<Node>& known = it->second;
+            return make_shared<Node>(
+              g, known->getHValue(), known->getDValue(),
+              known->getDErrValue(), domain.getGlobalEpsilonH(),
+              domain.getGlobalEpsilonD(), child, cur);
+        }
+
+        Cost f = cur->getFValue();
+        Cost h = Traits::isInfinite(f) ? f : (f > g ? f - g : Cost(0));
+
+        shared_ptr<Node> node = make_shared<Node>(
+          g, h, max(0.0, cur->getDValue() - 1),
+          max(0.0, cur->getDErrValue() - 1), domain.getGlobalEpsilonH(),
+          domain.getGlobalEpsilonD(), child, cur);
+        node->defer();
+        return node;
+    }
+
     void sortOpen(PriorityQueue<shared_ptr<Node>>& open)
     {
-        if (sortingFunction == "f")
+        if (order == OpenOrder::F)
             open.swapComparator(Node::compareNodesF);
-        else if (sortingFunction == "fhat")
+        else
             open.swapComparator(Node::compareNodesFHat);
     }
 
+    // buckets are always in f order
+    void sortOpen(BucketQueue<Node>&)
+    {
+        static_assert(order == OpenOrder::F,
+                      "a BucketQueue only keeps open in f order");
+    }
+
 protected:
-    Domain& domain;
-    size_t  lookahead;
-    string  sortingFunction;
+    // Make nodes of cur's children, put the new ones on open and in closed
+    // and learn the one-step error from the best of them.
+    template<class Open, class DuplicateDetection>
+    void addChildren(const shared_ptr<Node>&                  cur,
+                     const vector<State>&                     children,
+                     Open&                                    open,
+                     StateMap<State, shared_ptr<Node>, Hash>& closed,
+                     DuplicateDetection duplicateDetection)
+    {
+        shared_ptr<Node>         bestChildNode;
+        Cost                     bestF = Traits::infinity();
+        vector<shared_ptr<Node>> childrenNodes;
+
+        if (!lazy) {
+            evaluateChildren(children, HasBatchEvaluate<Domain>());
+        }
+
+        for (size_t i = 0; i < children.size(); ++i) {
+            const State& child = children[i];
+            Cost         g     = cur->getGValue() + domain.getEdgeCost(child);
+
+            shared_ptr<Node> childNode =
+              lazy ? deferredChild(child, g, cur, closed)
+                   : make_shared<Node>(g, childH[i], childD[i], childDErr[i],
+                                       domain.getGlobalEpsilonH(),
+                                       domain.getGlobalEpsilonD(), child, cur);
+
+            bool dup = duplicateDetection(childNode, closed, open);
+
+            if (!dup && childNode->getFValue() < bestF) {
+                bestF         = childNode->getFValue();
+                bestChildNode = childNode;
+            }
+
+            // Duplicate detection
+            if (!dup) {
+                open.push(childNode);
+                closed[child] = childNode;
+                childrenNodes.push_back(childNode);
+            }
+        }
+
+        // Learn path-based one-step error; lazily, once the child is
+        // evaluated
+        if (!lazy && !Traits::isInfinite(bestF)) {
+            /*for (auto child : childrenNodes) {*/
+                //child->pushPathBasedEpsilons(epsH, epsD);
+            /*}*/
+            learnOneStepError(cur->getState(), bestChildNode->getState());
+        }
+    }
+
+    // trace the node about to be expanded; true, with the solution marked
+    // found, if it is a goal
+    bool visit(const shared_ptr<Node>& cur, ResultContainer& res)
+    {
+        if (traceLevel >= TRACE_EXPANSIONS) {
+            cerr << "{state: '" << cur->getState().toString() << "',"
+                 << "g: " << my_to_string(cur->getGValue()) << ","
+                 << "h: " << my_to_string(cur->getHValue()) << ","
+                 << "f: " << my_to_string(cur->getFValue()) << ","
+                 << "epsH: " << my_to_string(cur->getEpsilonH()) << ","
+                 << "epsD: " << my_to_string(cur->getEpsilonD()) << ","
+                 << "expansion: " << expansions << "}" << endl;
+        }
+
+        if (traceLevel >= TRACE_SINK && trace) {
+            trace->state(TracePhase::VISITED, cur->getState());
+        }
+
+        domain.pushDelayWindow(cur->getDelayCntr());
+        // Check if current node is goal
+        if (domain.isGoal(cur->getState())) {
+            DEBUG_MSG("reach goal in expansion");
+            res.solutionFound = true;
+            return true;
+        }
+
+        return false;
+    }
+
+    void learnOneStepError(const State& parent, const State& child)
+    {
+        // Cost epsD = (1 + bestChildNode->getDValue()) -
+        // cur->getDValue();
+        double epsD = (1 + Traits::toDouble(domain.distance(child))) -
+                      Traits::toDouble(domain.distance(parent));
+        double epsH = Traits::toDouble(domain.getEdgeCost(child) +
+                                       domain.heuristic(child)) -
+                      Traits::toDouble(domain.heuristic(parent));
+
+        domain.pushGlobalEpsilons(epsH, epsD);
+    }
+
+    Domain&    domain;
+    size_t     lookahead;
+    // of the current lookahead, so an interrupted one can resume
+    size_t     expansions;
+    TraceSink* trace;
+    bool       lazy;
+
+    // the children's estimates, kept between expansions for their capacity
+    vector<Cost> childH;
+    vector<Cost> childD;
+    vector<Cost> childDErr;
 };
@@ -0,0 +1,138 @@
+#pragma once
+#include "../utility/CostTraits.h"
+#include "../utility/ResultContainer.h"
+#include "../utility/StateMap.h"
+#include "MetaReasonAStar.h"
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Whether a domain has the operator table partial expansion needs:
+//
+//     vector<State> successors(const State& state, Cost above, Cost upTo,
+//                              Cost& next) const;
+//
+// the successors whose edge cost plus heuristic lies in (above, upTo],
+// made without making the others, with `next` set to the least such value
+// over upTo (infinity if there is none). The values may use the domain's
+// heuristic before any learning.
+template<class Domain, class = void>
+struct HasOperatorTable : false_type
+{};
+
+template<class Domain>
+struct HasOperatorTable<
+  Domain, decltype(void(declval<const Domain&>().successors(
+            declval<const typename Domain::State&>(),
+            declval<typename Domain::Cost>(), declval<typename Domain::Cost>(),
+            declval<typename Domain::Cost&>())))> : true_type
+{};
+
+// Partial expansion A* for the lookahead, in f order. Expanding a node only
+// generates the children whose f is at most the node's, and puts the node
+// back on open with its f raised to that of the next of its children, so
+// the many children of a high branching factor that would sit on open until
+// the lookahead ends are never made into nodes, hashed or queued. The
+// domain's operator table (see HasOperatorTable) picks the children in
+// range from the change each move makes to the heuristic, so those out of
+// it are not even generated (EPEA*).
+//
+// Each partial expansion counts as one towards the lookahead. A node still
+// on open when the lookahead ends has its raised f, a lower bound on the
+// children it has left, for the learning and the decision.
+template<class Domain, class Node>
+class PartialExpansionAStar : public MetaReasonAStar<Domain, Node, OpenOrder::F>
+{
+    typedef MetaReasonAStar<Domain, Node, OpenOrder::F> Base;
+    typedef typename Domain::State                      State;
+    typedef typename Domain::Cost                       Cost;
+    typedef typename Domain::HashState                  Hash;
+    typedef CostTraits<Cost>                            Traits;
+
+    using Base::domain;
+    using Base::expansions;
+    using Base::lookahead;
+
+public:
+    PartialExpansionAStar(Domain& domain_, size_t lookahead_)
+        : Base(domain_, lookahead_)
+    {}
+
+    // see MetaReasonAStar::expand
+    template<class Open, class DuplicateDetection, class Stop>
+    bool expand(Open&                                    open,
+                StateMap<State, shared_ptr<Node>, Hash>& closed,
+                DuplicateDetection duplicateDetection, ResultContainer& res,
+                Stop&& stop)
+    {
+        while (!open.empty() && (expansions < lookahead)) {
+            if (expansions > 1 && stop()) {
+                return false;
+            }
+
+            shared_ptr<Node> cur = open.top();
+
+            if (this->visit(cur, res)) {
+                return true;
+            }
+
+            res.nodesExpanded++;
+            res.GATnodesExpanded++;
+            expansions++;
+
+            open.pop();
+
+            // Increment the delay counts for every other node on open
+            for (auto n : open) {
+                n->incDelayCntr();
+            }
+
+            // the children not generated yet whose f is up to cur's; all of
+            // them for the root, whose children the decision chooses from
+            Cost upTo =
+              cur->getParent() ? cur->getHValue() : Traits::infinity();
+            Cost          next;
+            vector<State> children = domain.successors(
+              cur->getState(), cur->getExpandedUpTo(), upTo, next);
+            res.nodesGenerated += children.size();
+
+            this->addChildren(cur, children, open, closed,
+                              duplicateDetection);
+
+            if (Traits::isInfinite(next)) {
+                cur->close();
+            } else {
+                cur->setExpandedUpTo(upTo);
+                cur->setHValue(next);
+                open.push(cur);
+            }
+        }
+
+        return true;
+    }
+
+    // A node left partially expanded has an h that bounds only the children
+    // it has not generated yet, above what the domain knows for its state.
+    // It is learnt as the node's own h for the learning to start from; the
+    // children it has generated may still lower it there.
+    template<class Open>
+    void endLookahead(Open&, StateMap<State, shared_ptr<Node>, Hash>& closed)
+    {
+        // closed has the nodes a beam dropped from open too
+        for (const auto& entry : closed) {
+            const shared_ptr<Node>& node = entry.second;
+            if (node->onOpen() &&
+                node->getExpandedUpTo() != numeric_limits<Cost>::lowest()) {
+                domain.updateHeuristic(node->getState(), node->getHValue());
+            }
+        }
+    }
+
+    // Partial expansion already leaves the children it does not need yet
+    // unmade, lazy evaluation has nothing to add.
+    void setLazyHeuristic(bool) {}
+};
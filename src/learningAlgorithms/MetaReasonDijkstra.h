@@ -1,9 +1,10 @@
 #pragma once
-#include "../utility/PriorityQueue.h"
+#include "../utility/CostTraits.h"
+#include "../utility/RadixHeap.h"
+#include "../utility/StateMap.h"
 #include "../utility/debug.h"
 #include <functional>
 #include <memory>
-#include <unordered_map>
 
 using namespace std;
 
@@ -13,52 +14,68 @@ class MetaReasonDijkstra
     typedef typename Domain::State     State;
     typedef typename Domain::Cost      Cost;
     typedef typename Domain::HashState Hash;
+    typedef CostTraits<Cost>           Traits;
 
 public:
     MetaReasonDijkstra(Domain& domain_)
         : domain(domain_)
     {}
 
-    void learn(PriorityQueue<shared_ptr<Node>>              open,
-               unordered_map<State, shared_ptr<Node>, Hash> closed)
+    template<class Open>
+    void learn(const Open&                                    open,
+               const StateMap<State, shared_ptr<Node>, Hash>& closed_)
     {
+        closed = closed_;
+
         // Start by initializing every state in closed to inf h
-        for (typename unordered_map<State, shared_ptr<Node>, Hash>::iterator
-               it = closed.begin();
-             it != closed.end(); it++) {
+        for (auto it = closed.begin(); it != closed.end(); it++) {
             if (!it->second->onOpen())
-                domain.updateHeuristic(it->first,
-                                       numeric_limits<double>::infinity());
+                domain.updateHeuristic(it->second->getState(),
+                                       Traits::infinity());
+            else if (!open.contains(it->second))
+                // dropped from a bounded open, still a frontier node
+                frontier.push(it->second->getHHatValue(), it->second);
         }
 
-        // Order open by h
-        open.swapComparator(Node::compareNodesHHat);
+        // Order open by h. A predecessor's h-hat is cur's plus the edge
+        // cost (it takes cur's d-hat and epsilon), so the keys only grow.
+        for (const auto& node : open) {
+            frontier.push(node->getHHatValue(), node);
+        }
 
         // Perform reverse dijkstra while closed is not empy
-        while (!closed.empty() && !open.empty()) {
-            shared_ptr<Node> cur = open.top();
-            open.pop();
+        while (!closed.empty() && !frontier.empty()) {
+            shared_ptr<Node> cur = frontier.top();
+            double           key = frontier.topKey();
+            frontier.pop();
+
+            // an entry superseded by a later push, or a node already done
+            if (key != cur->getHHatValue() ||
+                closed.erase(cur->getState()) == 0) {
+                continue;
+            }
 
-            closed.erase(cur->getState());
             auto preds = domain.predecessors(cur->getState());
             // DEBUG_MSG("open state: "<<cur->getState()<<"pred size: "<<
             // preds.size());
 
             // Now get all of the predecessors of cur
-            for (const State s : domain.predecessors(cur->getState())) {
+            for (const State& s : preds) {
                 // DEBUG_MSG("learning state: "<<s);
 
-                typename unordered_map<State, shared_ptr<Node>, Hash>::iterator
-                  it = closed.find(s);
+                auto it = closed.find(s);
 
-                if (it != closed.end() &&
-                    cur->getParent() == it->second && 
-                    domain.heuristic(s) > domain.getEdgeCost(cur->getState()) +
-                                            domain.heuristic(cur->getState())) {
+                if (it == closed.end() || cur->getParent() != it->second) {
+                    continue;
+                }
+
+                // saturates at the Cost's infinity
+                Cost h = Traits::sum(domain.getEdgeCost(cur->getState()),
+                                     domain.heuristic(cur->getState()));
+
+                if (domain.heuristic(s) > h) {
                     // Update the heuristic of this pedecessor
-                    domain.updateHeuristic(s,
-                                           domain.getEdgeCost(cur->getState()) +
-                                             domain.heuristic(cur->getState()));
+                    domain.updateHeuristic(s, h);
                     // Update the distance of this predecessor
                     domain.updateDistance(s,
                                           domain.distance(cur->getState()) + 1);
@@ -75,16 +92,20 @@ public:
                     //it->second->setEpsilonD(cur->getPathBasedEpsilonD());
                     it->second->setEpsilonD(cur->getEpsilonD());
 
-                    if (open.find(it->second) == open.end()) {
-                        open.push(it->second);
-                    } else {
-                        open.update(it->second);
-                    }
+                    frontier.push(it->second->getHHatValue(), it->second);
                 }
             }
         }
+
+        frontier.clear();
+        closed.clear();
     }
 
 protected:
     Domain& domain;
+
+    // kept between calls so its buckets keep their capacity
+    RadixHeap<shared_ptr<Node>> frontier;
+    // the closed nodes not yet reached by the pass, likewise kept
+    StateMap<State, shared_ptr<Node>, Hash> closed;
 };
@@ -1,14 +1,13 @@
-#include "RealTimeSearch.h"
-#include "domain/GridPathfinding.h"
-#include "domain/GridPathfindingWithTarPit.h"
-#include "domain/HeavyTilePuzzle.h"
-#include "domain/InverseTilePuzzle.h"
-#include "domain/PancakePuzzle.h"
-#include "domain/RaceTrack.h"
+#include "DomainSetup.h"
+#include "SearchRegistry.h"
+#include "utility/Random.h"
+#include "utility/TraceDecoder.h"
+#include "utility/TraceSink.h"
 
 #include <cxxopts.hpp>
 #include <nlohmann/json.hpp>
 
+#include <cstdio>
 #include <fstream>
 #include <iostream>
 #include <memory>
@@ -32,34 +31,26 @@ nlohmann::json parseResult(const ResultContainer&      res,
     record["algorithm"] =
       args["alg"].as<std::string>() + "-" + args["expan"].as<std::string>();
     record["lookahead"] = args["lookahead"].as<int>();
+    if (args.count("beam")) {
+        record["beam"] = args["beam"].as<int>();
+    }
+    if (args.count("lazy")) {
+        record["lazy"] = args["lazy"].as<bool>();
+    }
     record["domain"]    = args["domain"].as<std::string>();
     record["subdomain"] = args["subdomain"].as<std::string>();
 
     return record;
 }
 
-nlohmann::json parseVisResult(const ResultContainer& res)
-{
-
-    nlohmann::json record;
-
-    record["path"]           = res.paths;
-    record["visited"]        = res.visited;
-    record["isKeepThinking"] = res.isKeepThinkingFlags;
-    record["committed"]      = res.committed;
-
-    return record;
-}
-
 template<class Domain>
 ResultContainer startAlg(shared_ptr<Domain> domain_ptr, string expansionModule,
-                         string decisionModule, size_t lookahead)
+                         string decisionModule, size_t lookahead,
+                         const SearchOptions& searchOptions, TraceSink* trace)
 {
-    shared_ptr<RealTimeSearch<Domain>> searchAlg =
-      make_shared<RealTimeSearch<Domain>>(*domain_ptr, expansionModule,
-                                          decisionModule, lookahead);
-
-    return searchAlg->search();
+    return SearchRegistry<Domain>::run(*domain_ptr, expansionModule,
+                                       decisionModule, lookahead,
+                                       searchOptions, trace);
 }
 
 int main(int argc, char** argv)
@@ -74,20 +65,31 @@ int main(int argc, char** argv)
       cxxopts::value<std::string>()->default_value("gridPathfindingWithTarPit"));
 
     optionAdder("s,subdomain",
-                "puzzle type: uniform, inverse, heavy, sqrt; "
-                "pancake type: regular, heavy;"
-                "racetrack map : barto-bigger, hanse-bigger-double, uniform",
-                cxxopts::value<std::string>()->default_value("barto-bigger"));
+                "puzzle type: uniform, inverse, heavy; "
+                "pancake type: regular, heavy, sumheavy",
+                cxxopts::value<std::string>()->default_value("uniform"));
 
-    optionAdder("a,alg", "commit algorithm: one, alltheway, fhatpmr, dtrts",
+    optionAdder("a,alg",
+                "commit algorithm: one, alltheway, dynamicLookahead, dtrts, "
+                "dtrtsSpeculative",
                 cxxopts::value<std::string>()->default_value("risk"));
 
-    optionAdder("e,expan", "expansion algorithm: astar, fhat",
+    optionAdder("e,expan", "expansion algorithm: astar, fhat, epea",
                 cxxopts::value<std::string>()->default_value("risk"));
 
     optionAdder("l,lookahead", "expansion limit",
                 cxxopts::value<int>()->default_value("100"));
 
+    optionAdder("b,beam",
+                "most nodes open may hold during a lookahead, the worst are "
+                "dropped (default: no limit)",
+                cxxopts::value<int>()->default_value("0"));
+
+    optionAdder("lazy",
+                "compute children's heuristics only once they reach the top "
+                "of open",
+                cxxopts::value<bool>()->default_value("false"));
+
     optionAdder("o,performenceOut", "performence Out file",
                 cxxopts::value<std::string>());
 
@@ -95,7 +97,7 @@ int main(int argc, char** argv)
                 cxxopts::value<std::string>()->default_value("2-4x4.st"));
 
     optionAdder("f,heuristicType",
-                "gridPathfinding type : euclidean, mahattan;"
+                "gridPathfinding type : euclidean, manhattan, dijkstra;"
                 "racetrack type : euclidean, dijkstra;"
                 "pancake: gap,gapm1, gapm2",
                 cxxopts::value<std::string>()->default_value("euclidean"));
@@ -103,6 +105,23 @@ int main(int argc, char** argv)
     optionAdder("v,visOut", "visulization Out file",
                 cxxopts::value<std::string>());
 
+    optionAdder("t,traceOut",
+                "binary trace out file, decode it with traceDecoder",
+                cxxopts::value<std::string>());
+
+    optionAdder("m,map",
+                "binary map file made by mapConverter, read instead of the "
+                "map from stdin (racetrack then reads its start from stdin)",
+                cxxopts::value<std::string>());
+
+    optionAdder("c,cacheDir",
+                "directory of the goal-distance cache shared across runs "
+                "(default: $METAREASON_CACHE_DIR, off if unset)",
+                cxxopts::value<std::string>());
+
+    optionAdder("seed", "random seed, the same seed reproduces a run",
+                cxxopts::value<int>()->default_value("1"));
+
     optionAdder("h,help", "Print usage");
 
     auto args = options.parse(argc, argv);
@@ -118,63 +137,57 @@ int main(int argc, char** argv)
     auto lookaheadDepth = static_cast<size_t>(args["lookahead"].as<int>());
     auto expan          = args["expan"].as<std::string>();
 
-    ResultContainer res;
-
-    if (domain == "tile") {
-
-        /*   std::shared_ptr<SlidingTilePuzzle> world;*/
+    auto heuristicType  = args["heuristicType"].as<std::string>();
 
-        // if (subDomain == "uniform") {
-        // world = std::make_shared<SlidingTilePuzzle>(cin);
-        //} else if (subDomain == "heavy") {
-        // world = std::make_shared<HeavyTilePuzzle>(cin);
-        //} else if (subDomain == "inverse") {
-        // world = std::make_shared<InverseTilePuzzle>(cin);
-        //}
+    SearchOptions searchOptions;
+    searchOptions.beamWidth = static_cast<size_t>(args["beam"].as<int>());
+    searchOptions.lazyHeuristic = args["lazy"].as<bool>();
 
-        // res = startAlg<SlidingTilePuzzle>(world, alg, lookaheadDepth);
+    RandomGenerator::defaultSeed() =
+      static_cast<uint64_t>(args["seed"].as<int>());
 
-        /* } else if (domain == "pancake") {*/
-        // std::shared_ptr<PancakePuzzle> world =
-        // std::make_shared<PancakePuzzle>(cin);
-
-        // if (subDomain == "heavy") {
-        // world->setPuzzleVariant(1);
-        //} else if (subDomain == "sumheavy") {
-        // world->setPuzzleVariant(2);
-        //}
-
-        // res = startAlg<PancakePuzzle>(world, alg, lookaheadDepth);
-        //} else if (domain == "racetrack") {
+    if (args.count("cacheDir")) {
+        DistanceFieldCache::setDirectory(args["cacheDir"].as<std::string>());
+    }
 
-        // string mapFile = "/home/aifs1/gu/phd/research/workingPaper/"
-        //"realtime-nancy/worlds/racetrack/map/" +
-        // subDomain + ".track";
+    if (traceLevel < TRACE_SINK &&
+        (args.count("traceOut") || args.count("visOut"))) {
+        cerr << "tracing is compiled out, rebuild with TRACE_LEVEL >= "
+             << TRACE_SINK << " to use --traceOut or --visOut\n";
+        exit(1);
+    }
 
-        // ifstream map(mapFile);
+    // the visualization json is decoded from a temporary trace after the run
+    string traceFile;
+    if (args.count("traceOut")) {
+        traceFile = args["traceOut"].as<std::string>();
+    } else if (args.count("visOut")) {
+        traceFile = args["visOut"].as<std::string>() + ".trace";
+    }
 
-        // if (!map.good()) {
-        // cout << "map file not exist: " << mapFile << endl;
-        // exit(1);
-        //}
+    unique_ptr<BinaryTraceSink> trace;
+    if (!traceFile.empty()) {
+        trace = unique_ptr<BinaryTraceSink>(new BinaryTraceSink(traceFile));
+    }
 
-        // std::shared_ptr<RaceTrack> world =
-        // std::make_shared<RaceTrack>(map, cin);
+    ResultContainer res;
 
-        /*res = startAlg<RaceTrack>(world, alg, lookaheadDepth);*/
-    /*} else if (domain == "gridPathfinding") {*/
-        //std::shared_ptr<GridPathfinding> world =
-          //std::make_shared<GridPathfinding>(cin);
+    DomainOptions domainOptions;
+    domainOptions.domain        = domain;
+    domainOptions.subDomain     = subDomain;
+    domainOptions.heuristicType = heuristicType;
+    if (args.count("map")) {
+        domainOptions.mapFile = args["map"].as<std::string>();
+    }
 
-        //res = startAlg<GridPathfinding>(world, expan, alg, lookaheadDepth);
-    }  else if (domain == "gridPathfindingWithTarPit") {
-        std::shared_ptr<GridPathfindingWithTarPit> world =
-          std::make_shared<GridPathfindingWithTarPit>(cin);
+    bool knownDomain = withDomain(domainOptions, cin, [&](auto world) {
+        res = startAlg(world, expan, alg, lookaheadDepth, searchOptions,
+                       trace.get());
+    });
 
-        res = startAlg<GridPathfindingWithTarPit>(world, expan, alg, lookaheadDepth);
-    } else {
-        cout << "Available domains are TreeWorld, slidingTile, pancake, "
-                "racetrack, gridPathfinding"
+    if (!knownDomain) {
+        cout << "Available domains are gridPathfinding, "
+                "gridPathfindingWithTarPit, tile, pancake, racetrack"
              << endl;
         exit(1);
     }
@@ -192,11 +205,21 @@ int main(int argc, char** argv)
         cout << record << endl;
     }
 
+    // flush the trace before reading it back
+    trace.reset();
+
     // dumpout solution path
     if (args.count("visOut")) {
+        ifstream tin(traceFile, ios::binary);
+        auto     visJson = decodeTrace(tin);
+        tin.close();
+
         ofstream vout(args["visOut"].as<std::string>());
-        auto     visJson = parseVisResult(res);
         vout << visJson;
         vout.close();
+
+        if (!args.count("traceOut")) {
+            remove(traceFile.c_str());
+        }
     }
 }
@@ -0,0 +1,431 @@
+#include "Planner.h"
+#include "../DomainSetup.h"
+#include "../SearchRegistry.h"
+#include "../utility/Random.h"
+#include "../utility/SpscQueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+
+namespace metareason {
+
+class Planner::Impl
+{
+public:
+    virtual ~Impl() = default;
+
+    virtual bool           think(double seconds)            = 0;
+    virtual StepResult     commit()                         = 0;
+    virtual vector<string> bestCommitment()                 = 0;
+    virtual void           preempt()                        = 0;
+    virtual void           startBackground(size_t capacity) = 0;
+    virtual bool           nextState(string& state)         = 0;
+    virtual bool           backgroundDone() const           = 0;
+    virtual void           stopBackground()                 = 0;
+    virtual bool           observe(const string& state)     = 0;
+    virtual void           reset()                          = 0;
+    virtual string         currentState() const             = 0;
+    virtual bool           atGoal() const                   = 0;
+    virtual PlannerStats   stats() const                    = 0;
+};
+
+namespace {
+
+// One session on one domain. Tracks where the agent is, assuming it
+// executes what the planner commits to until observe() says otherwise.
+template<class Domain>
+class DomainPlanner final : public Planner::Impl
+{
+    using State   = typename Domain::State;
+    using Session = typename SearchRegistry<Domain>::Session;
+
+public:
+    DomainPlanner(shared_ptr<Domain> domain_,
+                  const typename SearchRegistry<Domain>::Entry& entry,
+                  size_t lookahead, const SearchOptions& options)
+        : domain(domain_)
+        , session(entry.makeSession(*domain, lookahead, options))
+        , current(domain->getStartState())
+        , finished(domain->isGoal(current))
+        , stepExpanded(0)
+        , stepGenerated(0)
+        , stepSeconds(0)
+        , preempted(false)
+        , executed(current)
+        , stopping(false)
+        , plannerDone(false)
+    {}
+
+    ~DomainPlanner() override { stopBackground(); }
+
+    bool think(double seconds) override
+    {
+        auto begin = chrono::steady_clock::now();
+        bool done  = true;
+
+        if (!finished && (session->isStepInProgress() || beginStep())) {
+            ThinkingBudget budget;
+            budget.preempted = &preempted;
+            if (seconds < numeric_limits<double>::max()) {
+                budget.deadline =
+                  begin + chrono::duration_cast<chrono::steady_clock::duration>(
+                            chrono::duration<double>(max(seconds, 0.0)));
+            }
+
+            done = session->think(res, budget);
+        }
+
+        preempted.store(false);
+        stepSeconds += secondsSince(begin);
+        return done;
+    }
+
+    StepResult commit() override
+    {
+        StepResult result;
+        for (const auto& s : commitStep(result)) {
+            result.states.push_back(s.toString());
+        }
+        return result;
+    }
+
+    vector<string> bestCommitment() override
+    {
+        vector<string> states;
+        for (const auto& s : session->bestCommitment()) {
+            states.push_back(s.toString());
+        }
+        return states;
+    }
+
+    void preempt() override { preempted.store(true); }
+
+    void startBackground(size_t capacity) override
+    {
+        if (planner.joinable()) {
+            return;
+        }
+
+        executed = current;
+        stopping.store(false);
+        plannerDone.store(false);
+        handOff.reset(new SpscQueue<State>(capacity));
+        planner = thread([this] { planAhead(); });
+    }
+
+    bool nextState(string& state) override
+    {
+        if (!handOff || !handOff->tryPop(executed)) {
+            return false;
+        }
+        state = executed.toString();
+        return true;
+    }
+
+    bool backgroundDone() const override
+    {
+        // everything pushed before plannerDone was raised is visible now
+        return plannerDone.load(memory_order_acquire) &&
+               (!handOff || handOff->empty());
+    }
+
+    void stopBackground() override
+    {
+        if (!planner.joinable()) {
+            return;
+        }
+
+        stopping.store(true);
+        preempt();
+        planner.join();
+        handOff.reset();
+        preempted.store(false);
+
+        if (!(executed == current)) {
+            moveTo(executed);
+        }
+    }
+
+    bool observe(const string& state) override
+    {
+        for (const auto& planned : plan) {
+            if (planned.toString() == state) {
+                return moveTo(planned);
+            }
+        }
+
+        for (const auto& planned : plan) {
+            for (const auto& s : domain->successors(planned)) {
+                if (s.toString() == state) {
+                    return moveTo(s);
+                }
+            }
+        }
+
+        return false;
+    }
+
+    void reset() override
+    {
+        session->reset();
+        current   = domain->getStartState();
+        finished  = domain->isGoal(current);
+        res       = ResultContainer();
+        stepStats = PlannerStats();
+        plan.clear();
+    }
+
+    string currentState() const override { return current.toString(); }
+
+    bool atGoal() const override { return domain->isGoal(current); }
+
+    PlannerStats stats() const override
+    {
+        PlannerStats s   = stepStats;
+        s.nodesExpanded  = res.nodesExpanded;
+        s.nodesGenerated = res.nodesGenerated;
+        return s;
+    }
+
+private:
+    // the session starts thinking about the next step; false if it is
+    // already at the goal
+    bool beginStep()
+    {
+        stepExpanded  = res.nodesExpanded;
+        stepGenerated = res.nodesGenerated;
+        stepSeconds   = 0;
+        return session->beginStep(res);
+    }
+
+    // end the step, see commit()
+    vector<State> commitStep(StepResult& result)
+    {
+        vector<State> committed;
+        if (!finished) {
+            auto begin = chrono::steady_clock::now();
+
+            bool more = session->isStepInProgress() || beginStep();
+
+            if (more) {
+                more = session->endStep(res, &committed);
+            }
+
+            result.seconds        = stepSeconds + secondsSince(begin);
+            result.nodesExpanded  = res.nodesExpanded - stepExpanded;
+            result.nodesGenerated = res.nodesGenerated - stepGenerated;
+
+            plan.assign(1, current);
+            for (const auto& s : committed) {
+                current = s;
+                plan.push_back(s);
+                stepStats.solutionCost += domain->getEdgeCost(s);
+                ++stepStats.solutionLength;
+            }
+            ++stepStats.steps;
+
+            finished = !more || domain->isGoal(current);
+        }
+
+        result.goalReached = finished && domain->isGoal(current);
+        result.deadEnd     = finished && !result.goalReached;
+        return committed;
+    }
+
+    // the step() loop of the planner thread, handing every committed state
+    // over as soon as it is committed
+    void planAhead()
+    {
+        while (!finished && !stopping.load()) {
+            think(numeric_limits<double>::infinity());
+            if (stopping.load()) {
+                break;
+            }
+
+            StepResult result;
+            for (const auto& s : commitStep(result)) {
+                while (!handOff->tryPush(s)) {
+                    if (stopping.load(memory_order_relaxed)) {
+                        plannerDone.store(true, memory_order_release);
+                        return;
+                    }
+                    this_thread::yield();
+                }
+            }
+        }
+
+        plannerDone.store(true, memory_order_release);
+    }
+
+    static double secondsSince(chrono::steady_clock::time_point begin)
+    {
+        return chrono::duration<double>(chrono::steady_clock::now() - begin)
+          .count();
+    }
+
+    bool moveTo(State s)
+    {
+        current = s;
+        plan.assign(1, s);
+        session->observe(s);
+        finished = domain->isGoal(s);
+        return true;
+    }
+
+    shared_ptr<Domain>  domain;
+    unique_ptr<Session> session;
+    State               current;
+    // where the last step started and what it committed to
+    vector<State>   plan;
+    bool            finished;
+    ResultContainer res;
+    PlannerStats    stepStats;
+    // the step being thought about, over all its slices
+    size_t stepExpanded;
+    size_t stepGenerated;
+    double stepSeconds;
+    // raised by preempt(), possibly from another thread
+    atomic<bool> preempted;
+
+    // background planning: the planner thread commits and pushes, the
+    // caller pops into `executed`
+    unique_ptr<SpscQueue<State>> handOff;
+    thread                       planner;
+    State                        executed;
+    atomic<bool>                 stopping;
+    atomic<bool>                 plannerDone;
+};
+
+} // namespace
+
+Planner::Planner(unique_ptr<Impl> impl_)
+    : impl(std::move(impl_))
+{}
+
+Planner::~Planner() = default;
+
+unique_ptr<Planner> Planner::create(const PlannerConfig& config,
+                                    const string& instance, string* error)
+{
+    RandomGenerator::defaultSeed() = config.seed;
+
+    DomainOptions options;
+    options.domain        = config.domain;
+    options.subDomain     = config.subDomain;
+    options.heuristicType = config.heuristicType;
+    options.mapFile       = config.mapFile;
+
+    unique_ptr<Impl> impl;
+    string           reason;
+    stringstream     in(instance);
+
+    bool knownDomain = withDomain(options, in, [&](auto world) {
+        using Domain = typename decltype(world)::element_type;
+
+        auto entry = SearchRegistry<Domain>::lookup(config.expansion,
+                                                    config.decision);
+        if (!entry) {
+            reason = "unknown expansion/decision module: " +
+                     config.expansion + "/" + config.decision;
+            return;
+        }
+
+        SearchOptions searchOptions;
+        searchOptions.beamWidth     = config.beamWidth;
+        searchOptions.lazyHeuristic = config.lazyHeuristic;
+
+        impl = unique_ptr<Impl>(new DomainPlanner<Domain>(
+          world, *entry, config.lookahead, searchOptions));
+    });
+
+    if (!knownDomain) {
+        reason = "unknown domain: " + config.domain;
+    }
+
+    if (!impl) {
+        if (error) {
+            *error = reason;
+        }
+        return nullptr;
+    }
+
+    return unique_ptr<Planner>(new Planner(std::move(impl)));
+}
+
+StepResult Planner::step()
+{
+    impl->think(numeric_limits<double>::infinity());
+    return impl->commit();
+}
+
+bool Planner::think(double seconds)
+{
+    return impl->think(seconds);
+}
+
+StepResult Planner::commit()
+{
+    return impl->commit();
+}
+
+vector<string> Planner::bestCommitment()
+{
+    return impl->bestCommitment();
+}
+
+void Planner::preempt()
+{
+    impl->preempt();
+}
+
+void Planner::startBackground(size_t capacity)
+{
+    impl->startBackground(capacity);
+}
+
+bool Planner::nextState(string& state)
+{
+    return impl->nextState(state);
+}
+
+bool Planner::backgroundDone() const
+{
+    return impl->backgroundDone();
+}
+
+void Planner::stopBackground()
+{
+    impl->stopBackground();
+}
+
+bool Planner::observe(const string& state)
+{
+    return impl->observe(state);
+}
+
+void Planner::reset()
+{
+    impl->reset();
+}
+
+string Planner::currentState() const
+{
+    return impl->currentState();
+}
+
+bool Planner::atGoal() const
+{
+    return impl->atGoal();
+}
+
+PlannerStats Planner::stats() const
+{
+    return impl->stats();
+}
+
+} // namespace metareason
@@ -0,0 +1,146 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The embeddable planner (libmetareason). This header is the whole public
+// interface: it only uses standard types and keeps the search behind a
+// pointer, so callers never see the search templates (and unlike the rest
+// of the tree it does not pull namespace std into the including file).
+namespace metareason {
+
+struct PlannerConfig
+{
+    // gridPathfinding, gridPathfindingWithTarPit, tile, pancake, racetrack
+    std::string domain = "gridPathfindingWithTarPit";
+    // tile: uniform, heavy, inverse; pancake: regular, heavy, sumheavy
+    std::string subDomain = "uniform";
+    // grid: euclidean, manhattan, dijkstra; racetrack: euclidean, dijkstra;
+    // pancake: gap, gapm1, gapm2
+    std::string heuristicType = "euclidean";
+    // astar, fhat, epea (tile and pancake)
+    std::string expansion = "fhat";
+    // one, alltheway, dynamicLookahead, dtrts, dtrtsSpeculative
+    std::string decision = "dtrts";
+    // node expansions each step may spend on its lookahead
+    size_t lookahead = 100;
+    // most nodes the lookahead keeps on open, dropping the worst; 0 for no
+    // limit
+    size_t beamWidth = 0;
+    // compute children's heuristics only once they reach the top of open
+    bool lazyHeuristic = false;
+    // process-wide random seed, shared with every planner in the process
+    uint64_t seed = 1;
+    // binary map made by mapConverter; the instance text then only holds
+    // the racetrack start and is ignored by the grid domains
+    std::string mapFile;
+};
+
+struct StepResult
+{
+    // the states committed to, in the order the agent should move through
+    // them, in the domain's text form
+    std::vector<std::string> states;
+    bool                     goalReached = false;
+    bool                     deadEnd     = false;
+    // search effort and wall time of this step, summed over its slices
+    size_t nodesExpanded  = 0;
+    size_t nodesGenerated = 0;
+    double seconds        = 0;
+};
+
+// totals of the current episode, the cost is that of the committed actions
+struct PlannerStats
+{
+    double solutionCost   = 0;
+    size_t solutionLength = 0;
+    size_t nodesExpanded  = 0;
+    size_t nodesGenerated = 0;
+    size_t steps          = 0;
+};
+
+class Planner
+{
+public:
+    // Build the domain from the instance text (the same text realtimeSolver
+    // reads from stdin) and start a session at its start state. Returns
+    // nullptr, with the reason in `error`, if the domain or the
+    // expansion/decision pair is unknown.
+    static std::unique_ptr<Planner> create(const PlannerConfig& config,
+                                           const std::string&   instance,
+                                           std::string* error = nullptr);
+
+    ~Planner();
+
+    Planner(const Planner&) = delete;
+    Planner& operator=(const Planner&) = delete;
+
+    // Think for one lookahead and return the actions committed to; the
+    // planner assumes the agent executes them. Once the goal is committed
+    // to or the search is stuck, every further step returns no states.
+    StepResult step();
+
+    // The same step in slices, for a control loop with a different amount
+    // of slack every tick. think() spends at most about `seconds` on the
+    // step (starting one if none is in progress) and returns true once the
+    // search has nothing more to think about; otherwise the next call
+    // resumes where this one stopped. commit() ends the step, cutting the
+    // thinking short if need be, and returns what step() would have.
+    bool       think(double seconds);
+    StepResult commit();
+
+    // What commit() would return right now, empty before the current step
+    // has expanded anything.
+    std::vector<std::string> bestCommitment();
+
+    // Make the think() (or step()) running on another thread return as
+    // soon as possible. The only call that may be made concurrently; one
+    // that arrives between calls makes the next think() return at once.
+    void preempt();
+
+    // Background planning: a planner thread keeps stepping, each step
+    // thinking from where the states committed before it leave the agent,
+    // while the caller executes those. The states reach the caller through
+    // a lock-free single-producer single-consumer queue of `capacity`
+    // states; the planner waits while it is full. Until stopBackground(),
+    // only nextState(), backgroundDone() and preempt() may be called.
+    void startBackground(size_t capacity = 64);
+
+    // The next committed state to move to (text form), false if the
+    // planner has not committed to one yet.
+    bool nextState(std::string& state);
+
+    // The planner thread has committed to the goal or run into a dead end,
+    // and nextState() has handed out everything it committed to.
+    bool backgroundDone() const;
+
+    // Stop the planner thread. The agent is taken to be in the last state
+    // nextState() returned (or where background planning started); what
+    // was committed after it is dropped.
+    void stopBackground();
+
+    // The agent was seen in `state` (text form) instead of where the plan
+    // put it: the planned actions are dropped and the next step thinks
+    // from there. The state must be where the last step started, one it
+    // committed to, or a successor of one of those; returns false,
+    // changing nothing, otherwise.
+    bool observe(const std::string& state);
+
+    // back to the start state, keeping what the search has learned
+    void reset();
+
+    std::string  currentState() const;
+    bool         atGoal() const;
+    PlannerStats stats() const;
+
+    class Impl;
+
+private:
+    explicit Planner(std::unique_ptr<Impl> impl_);
+
+    std::unique_ptr<Impl> impl;
+};
+
+} // namespace metareason
@@ -1,7 +1,11 @@
 #pragma once
+#include <atomic>
+#include <cstdint>
+#include <limits>
 #include <memory>
 
-#include "utility/DiscreteDistribution.h"
+#include "utility/BucketQueue.h"
+#include "utility/CostTraits.h"
 #include "utility/debug.h"
 
 using namespace std;
@@ -12,145 +16,139 @@ class SearchNode
     typedef typename Domain::State     State;
     typedef typename Domain::Cost      Cost;
     typedef typename Domain::HashState Hash;
-
-    Cost                 g;
-    Cost                 h;
-    Cost                 d;
-    Cost                 derr;
-    bool                 open;
-    unsigned int         delayCntr;
-    DiscreteDistribution distribution;
-
-    double startEpsilonH;
-    double startEpsilonD;
-
-    double       curEpsilonH;
-    double       curEpsilonD;
-    unsigned int expansionCounter;
+    typedef CostTraits<Cost>           Traits;
+
+    // read by every expansion and heap comparison, in the domain's Cost
+    Cost g;
+    Cost h;
+    // sort keys, recomputed whenever one of their inputs changes so heap
+    // comparisons only read plain numbers
+    Cost   f;
+    // partial expansion: the children whose edge cost plus heuristic is up
+    // to this are generated (see PartialExpansionAStar), lowest() while
+    // none are; an int Cost fills the gap before the doubles
+    Cost   expandedUpTo;
+    double hHat;
+    double fHat;
+    // the estimates behind h-hat are floating point whatever the Cost
+    double d;
+    double derr;
+    double curEpsilonH;
+    double curEpsilonD;
 
     shared_ptr<SearchNode<Domain>> parent;
-    State                          stateRep;
+    uint64_t                       sequence;
+    BucketSlot                     bucket;
+    unsigned int                   delayCntr;
+    bool                           open;
+    // h, d and derr are still the bounds the node was generated with, see
+    // MetaReasonAStar::setLazyHeuristic
+    bool                           deferred;
 
-    shared_ptr<SearchNode<Domain>> nancyFrontier;
-    Cost                           backupHHat;
+    State stateRep;
 
-public:
-    Cost getGValue() const { return g; }
-    Cost getHValue() const { return h; }
-    Cost getDValue() const { return d; }
-    Cost getDErrValue() const { return derr; }
-    Cost getFValue() const { return g + h; }
-    Cost getFHatValue() const { return g + getHHatValue(); }
-    Cost getDHatValue() const { return (derr / (1.0 - curEpsilonD)); }
-    Cost getHHatValue() const { return h + getDHatValue() * curEpsilonH; }
-    Cost getBackupHHatValue() const { return backupHHat; }
-    shared_ptr<SearchNode<Domain>> getNancyFrontier() const
-    {
-        return nancyFrontier;
-    }
+    // What only a decision module needs (the Nancy backup's h-hat and
+    // frontier) is kept by that module, see MetaReasonNancyBackup::Backup.
 
-    State                          getState() const { return stateRep; }
+public:
+    Cost   getGValue() const { return g; }
+    Cost   getHValue() const { return h; }
+    double getDValue() const { return d; }
+    double getDErrValue() const { return derr; }
+    Cost   getFValue() const { return f; }
+    double getFHatValue() const { return fHat; }
+    double getDHatValue() const { return (derr / (1.0 - curEpsilonD)); }
+    double getHHatValue() const { return hHat; }
+
+    const State&                   getState() const { return stateRep; }
     shared_ptr<SearchNode<Domain>> getParent() const { return parent; }
 
-    //Cost         getPathBasedEpsilonH() const { return curEpsilonH; }
-    //Cost         getPathBasedEpsilonD() const { return curEpsilonD; }
+    //double       getPathBasedEpsilonH() const { return curEpsilonH; }
+    //double       getPathBasedEpsilonD() const { return curEpsilonD; }
     
-    Cost         getEpsilonH() const { return curEpsilonH; }
-    Cost         getEpsilonD() const { return curEpsilonD; }
-    /*unsigned int getPathBasedExpansionCounter() const*/
-    //{
-        //return expansionCounter;
-    /*}*/
-
-    void setHValue(Cost val) { h = val; }
-    void setGValue(Cost val) { g = val; }
-    void setDValue(Cost val) { d = val; }
-    void setDErrValue(Cost val) { derr = val; }
-    void setEpsilonH(Cost val) { curEpsilonH = val; }
-    void setEpsilonD(Cost val) { curEpsilonD = val; }
-    void setState(State s) { stateRep = s; }
-    void setParent(shared_ptr<SearchNode<Domain>> p) { parent = p; }
-    void setBackupHHat(Cost val) { backupHHat = val; }
-    void setNancyFrontier(shared_ptr<SearchNode<Domain>> n)
+    double       getEpsilonH() const { return curEpsilonH; }
+    double       getEpsilonD() const { return curEpsilonD; }
+
+    // creation order, the last tie-breaker of the comparators
+    uint64_t getSequence() const { return sequence; }
+
+    BucketSlot& bucketSlot() { return bucket; }
+
+    void setHValue(Cost val)
+    {
+        h = val;
+        updateSortKeys();
+    }
+    // a node reached by a new path has all its children to generate again
+    void setGValue(Cost val)
+    {
+        g            = val;
+        expandedUpTo = numeric_limits<Cost>::lowest();
+        updateSortKeys();
+    }
+    void setDValue(double val) { d = val; }
+    void setDErrValue(double val)
     {
-        nancyFrontier = n;
+        derr = val;
+        updateSortKeys();
     }
+    void setEpsilonH(double val)
+    {
+        curEpsilonH = val;
+        updateSortKeys();
+    }
+    void setEpsilonD(double val)
+    {
+        curEpsilonD = val;
+        updateSortKeys();
+    }
+    void setState(const State& s) { stateRep = s; }
+    void setParent(shared_ptr<SearchNode<Domain>> p) { parent = p; }
 
     bool onOpen() { return open; }
     void close() { open = false; }
     void reOpen() { open = true; }
 
+    bool isDeferred() const { return deferred; }
+    void defer() { deferred = true; }
+    void evaluated() { deferred = false; }
+
     void markStart() { stateRep.markStart(); }
 
+    Cost getExpandedUpTo() const { return expandedUpTo; }
+    void setExpandedUpTo(Cost val) { expandedUpTo = val; }
+
     void         incDelayCntr() { ++delayCntr; }
     unsigned int getDelayCntr() { return delayCntr; }
 
-    void resetStartEpsilons()
-    {
-        startEpsilonD = curEpsilonD;
-        startEpsilonH = curEpsilonH;
-    }
-
-    /*void pushPathBasedEpsilons(double epsH_, double epsD_)*/
-    //{
-        //incExpansionCounter();
-        //pushEpsilonHPathBased(epsH_);
-        //pushEpsilonDPathBased(epsD_);
-    /*}*/
-
-    /*void incExpansionCounter() { ++expansionCounter; }*/
-
-    //void pushEpsilonHPathBased(double eps)
-    //{
-        //if (expansionCounter < 5) {
-            //curEpsilonH = startEpsilonH;
-            //return;
-        //}
-
-        //// DEBUG_MSG("epsh " + to_string(eps));
-        //// DEBUG_MSG("expCounter " + to_string(expansionCounter));
-
-        //curEpsilonH -= curEpsilonH / expansionCounter;
-        //curEpsilonH += eps / expansionCounter;
-    //}
-
-    //void pushEpsilonDPathBased(double eps)
-    //{
-        //if (expansionCounter < 5) {
-            //curEpsilonD = startEpsilonD;
-            //return;
-        //}
-
-        //curEpsilonD -= curEpsilonD / expansionCounter;
-        //curEpsilonD += eps / expansionCounter;
-    /*}*/
-
-    SearchNode<Domain>(Cost g_, Cost h_, Cost d_, Cost derr_, Cost epsH_,
-                       Cost epsD_, unsigned int expansionCounter_, State state_,
+    SearchNode<Domain>(Cost g_, Cost h_, double d_, double derr_,
+                       double epsH_, double epsD_, const State& state_,
                        shared_ptr<SearchNode<Domain>> parent_)
         : g(g_)
         , h(h_)
+        , expandedUpTo(numeric_limits<Cost>::lowest())
         , d(d_)
         , derr(derr_)
-        , startEpsilonH(epsH_)
-        , startEpsilonD(epsD_)
         , curEpsilonH(epsH_)
         , curEpsilonD(epsD_)
-        , expansionCounter(expansionCounter_)
         , parent(parent_)
+        , sequence(nextSequence().fetch_add(1, memory_order_relaxed))
+        , bucket{0, 0, 0, BucketSlot::NONE}
+        , delayCntr(0)
+        , open(true)
+        , deferred(false)
         , stateRep(state_)
     {
-        open      = true;
-        delayCntr = 0;
+        updateSortKeys();
     }
 
     string toString() const
     {
         string str = "";
         str += "{state: " + stateRep.toString() + ",";
-        str += "f: " + my_to_string(getFValue()) + ",";
-        str += "g: " + my_to_string(getGValue()) + ",";
-        str += "h: " + my_to_string(getHValue()) + ",";
+        str += "f: " + my_to_string(Traits::toDouble(f)) + ",";
+        str += "g: " + my_to_string(Traits::toDouble(g)) + ",";
+        str += "h: " + my_to_string(Traits::toDouble(h)) + ",";
         str += "derr: " + my_to_string(getDErrValue()) + ",";
         str += "d: " + my_to_string(getDValue()) + ",";
         str += "epsilon-h: " + my_to_string(getEpsilonH()) + ",";
@@ -158,7 +156,6 @@ public:
         str += "f-hat: " + my_to_string(getFHatValue()) + ",";
         str += "d-hat: " + my_to_string(getDHatValue()) + ",";
         str += "h-hat: " + my_to_string(getHHatValue()) + ",";
-        str += "backed h-hat: " + my_to_string(getBackupHHatValue()) + ",";
         if (getParent() == nullptr) {
             str += "parent: null }";
         } else {
@@ -167,62 +164,53 @@ public:
         return str;
     }
 
-    static bool compareNodesF(const shared_ptr<SearchNode<Domain>> n1,
-                              const shared_ptr<SearchNode<Domain>> n2)
+    static bool compareNodesF(const shared_ptr<SearchNode<Domain>>& n1,
+                              const shared_ptr<SearchNode<Domain>>& n2)
     {
         // Tie break on g-value
-        if (n1->getFValue() == n2->getFValue()) {
-            return n1->getGValue() > n2->getGValue();
+        if (n1->f != n2->f) {
+            return n1->f < n2->f;
         }
-        return n1->getFValue() < n2->getFValue();
+        return n1->g > n2->g;
     }
 
-    static bool compareNodesFHat(const shared_ptr<SearchNode<Domain>> n1,
-                                 const shared_ptr<SearchNode<Domain>> n2)
+    static bool compareNodesFHat(const shared_ptr<SearchNode<Domain>>& n1,
+                                 const shared_ptr<SearchNode<Domain>>& n2)
     {
-        // Tie break on g-value
-        if (n1->getFHatValue() == n2->getFHatValue()) {
-            if (n1->getFValue() == n2->getFValue()) {
-                if (n1->getGValue() == n2->getGValue()) {
-                    return n1->getState().key() > n2->getState().key();
-                }
-                return n1->getGValue() > n2->getGValue();
-            }
-            return n1->getFValue() < n2->getFValue();
+        // Tie break on f, then g, then the older node
+        if (n1->fHat != n2->fHat) {
+            return n1->fHat < n2->fHat;
         }
-        return n1->getFHatValue() < n2->getFHatValue();
-    }
-
-    static bool compareNodesH(const shared_ptr<SearchNode<Domain>> n1,
-                              const shared_ptr<SearchNode<Domain>> n2)
-    {
-        if (n1->getHValue() == n2->getHValue()) {
-            return n1->getGValue() > n2->getGValue();
+        if (n1->f != n2->f) {
+            return n1->f < n2->f;
+        }
+        if (n1->g != n2->g) {
+            return n1->g > n2->g;
         }
-        return n1->getHValue() < n2->getHValue();
+        return n1->sequence < n2->sequence;
     }
 
-    static bool compareNodesHHat(const shared_ptr<SearchNode<Domain>> n1,
-                                 const shared_ptr<SearchNode<Domain>> n2)
+    static bool compareNodesH(const shared_ptr<SearchNode<Domain>>& n1,
+                              const shared_ptr<SearchNode<Domain>>& n2)
     {
-        if (n1->getHHatValue() == n2->getHHatValue()) {
-            return n1->getGValue() > n2->getGValue();
+        if (n1->h != n2->h) {
+            return n1->h < n2->h;
         }
-        return n1->getHHatValue() < n2->getHHatValue();
+        return n1->g > n2->g;
     }
 
-    static bool compareNodesBackedHHat(const shared_ptr<SearchNode<Domain>> n1,
-                                       const shared_ptr<SearchNode<Domain>> n2)
+    static bool compareNodesHHat(const shared_ptr<SearchNode<Domain>>& n1,
+                                 const shared_ptr<SearchNode<Domain>>& n2)
     {
-        /*if (n1->backupHHat == n2->backupHHat) {*/
-        // return n1->getGValue() > n2->getGValue();
-        /*}*/
-        return n1->backupHHat < n2->backupHHat;
+        if (n1->hHat != n2->hHat) {
+            return n1->hHat < n2->hHat;
+        }
+        return n1->g > n2->g;
     }
 
     static double getLowerConfidence(const shared_ptr<SearchNode<Domain>> n)
     {
-        double f    = n->getFValue();
+        double f    = Traits::toDouble(n->getFValue());
         double mean = n->getFHatValue();
         if (f == mean) {
             return f;
@@ -234,8 +222,23 @@ public:
         return max(f, mean - (1.96 * var));
     }
 
-    static bool compareNodesLC(const shared_ptr<SearchNode<Domain>> n1,
-                               const shared_ptr<SearchNode<Domain>> n2)
+private:
+    void updateSortKeys()
+    {
+        f    = Traits::sum(g, h);
+        hHat = Traits::toDouble(h) + getDHatValue() * curEpsilonH;
+        fHat = Traits::toDouble(g) + hHat;
+    }
+
+    // shared by searches on other threads (libmetareason's planner thread)
+    static atomic<uint64_t>& nextSequence()
+    {
+        static atomic<uint64_t> next(0);
+        return next;
+    }
+
+    static bool compareNodesLC(const shared_ptr<SearchNode<Domain>>& n1,
+                               const shared_ptr<SearchNode<Domain>>& n2)
     {
         // Lower confidence interval
         if (getLowerConfidence(n1) == getLowerConfidence(n2)) {
@@ -0,0 +1,63 @@
+#include "../domain/GridPathfinding.h"
+#include "../domain/GridPathfindingWithTarPit.h"
+#include "../domain/RaceTrack.h"
+
+#include <cxxopts.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+// Convert a text map (read from stdin) into the binary map format that
+// realtimeSolver can mmap with --map.
+int main(int argc, char** argv)
+{
+    cxxopts::Options options("./mapConverter",
+                             "Convert a text map into the binary map format");
+
+    auto optionAdder = options.add_options();
+
+    optionAdder("d,domain",
+                "domain type: gridPathfinding, gridPathfindingWithTarPit, "
+                "racetrack",
+                cxxopts::value<std::string>()->default_value(
+                  "gridPathfindingWithTarPit"));
+
+    optionAdder("o,out", "binary map Out file", cxxopts::value<std::string>());
+
+    optionAdder("h,help", "Print usage");
+
+    auto args = options.parse(argc, argv);
+
+    if (args.count("help") || !args.count("out")) {
+        std::cout << options.help() << std::endl;
+        exit(0);
+    }
+
+    auto domain = args["domain"].as<std::string>();
+
+    ofstream out(args["out"].as<std::string>(), ios::binary);
+
+    if (!out.good()) {
+        cerr << "can not write: " << args["out"].as<std::string>() << "\n";
+        exit(1);
+    }
+
+    if (domain == "gridPathfinding") {
+        GridPathfinding world(cin);
+        world.writeBinaryMap(out);
+    } else if (domain == "gridPathfindingWithTarPit") {
+        GridPathfindingWithTarPit world(cin);
+        world.writeBinaryMap(out);
+    } else if (domain == "racetrack") {
+        RaceTrack world(cin);
+        world.writeBinaryMap(out);
+    } else {
+        cerr << "unknown domain: " << domain << "\n";
+        exit(1);
+    }
+
+    out.close();
+}
@@ -0,0 +1,50 @@
+#include "../utility/TraceDecoder.h"
+
+#include <cxxopts.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+// Turn a binary trace (realtimeSolver --traceOut) into the visualization
+// json that --visOut writes.
+int main(int argc, char** argv)
+{
+    cxxopts::Options options("./traceDecoder",
+                             "Decode a binary search trace into json");
+
+    auto optionAdder = options.add_options();
+
+    optionAdder("i,in", "binary trace file", cxxopts::value<std::string>());
+
+    optionAdder("o,out", "visulization Out file",
+                cxxopts::value<std::string>());
+
+    optionAdder("h,help", "Print usage");
+
+    auto args = options.parse(argc, argv);
+
+    if (args.count("help") || !args.count("in")) {
+        std::cout << options.help() << std::endl;
+        exit(0);
+    }
+
+    ifstream in(args["in"].as<std::string>(), ios::binary);
+
+    if (!in.good()) {
+        cerr << "can not read: " << args["in"].as<std::string>() << "\n";
+        exit(1);
+    }
+
+    auto visJson = decodeTrace(in);
+
+    if (args.count("out")) {
+        ofstream out(args["out"].as<std::string>());
+        out << visJson;
+        out.close();
+    } else {
+        cout << visJson << endl;
+    }
+}
@@ -0,0 +1,216 @@
+#pragma once
+#include "CostTraits.h"
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+// Where a node sits in a BucketQueue: the f and g it was filed under (the
+// node's own values may already have changed when it is updated) and its
+// positions in its bucket and in the queue's list of all nodes. 32 bits
+// each, since every node carries one.
+struct BucketSlot
+{
+    static constexpr uint32_t NONE = numeric_limits<uint32_t>::max();
+
+    uint32_t f;
+    uint32_t g;
+    uint32_t index;
+    uint32_t item;
+};
+
+// An open list for f-ordered search on domains whose edge costs and
+// heuristics are all integers (Domain::hasIntegralCosts): nodes are filed in
+// a bucket per f and, within it, per g, so push, pop and update take
+// amortized constant time and need no hash map. The order is that of
+// SearchNode::compareNodesF (lowest f, then highest g); among equals mostly
+// the newest node first.
+// Nodes with an infinite f (see CostTraits::isInfinite) are kept apart and
+// come last.
+//
+// Node provides BucketSlot& bucketSlot() for the queue to keep its place
+// in; a node is on at most one BucketQueue at a time.
+template<class Node>
+class BucketQueue
+{
+    typedef shared_ptr<Node> Item;
+
+    // nodes of one f by g; the best are those of the highest g, topG
+    struct FBucket
+    {
+        vector<vector<Item>> byG;
+        size_t               count = 0;
+        size_t               topG  = 0;
+    };
+
+    static constexpr uint32_t INFINITE = BucketSlot::NONE;
+
+public:
+    BucketQueue()
+        : base(0)
+        , best(0)
+    {}
+
+    bool empty() const { return items.empty(); }
+
+    size_t size() const { return items.size(); }
+
+    const Item top() const
+    {
+        if (best < levels.size()) {
+            const auto& level = levels[best];
+            return level.byG[level.topG].back();
+        }
+        return infinite.back();
+    }
+
+    void push(const Item& item)
+    {
+        BucketSlot& slot = item->bucketSlot();
+        slot.item        = static_cast<uint32_t>(items.size());
+        items.push_back(item);
+
+        auto f = item->getFValue();
+        if (CostTraits<decltype(f)>::isInfinite(f)) {
+            slot.f     = INFINITE;
+            slot.index = static_cast<uint32_t>(infinite.size());
+            infinite.push_back(item);
+            return;
+        }
+
+        assert(f == floor(f) &&
+               item->getGValue() == floor(item->getGValue()) &&
+               static_cast<double>(f) < INFINITE);
+        slot.f = static_cast<uint32_t>(f);
+        slot.g = static_cast<uint32_t>(item->getGValue());
+
+        bool  onlyInfinite = best >= levels.size();
+        auto& level        = levelOf(slot.f);
+        if (slot.g >= level.byG.size()) {
+            level.byG.resize(slot.g + 1);
+        }
+        auto& bucket = level.byG[slot.g];
+
+        slot.index = static_cast<uint32_t>(bucket.size());
+        bucket.push_back(item);
+        level.topG =
+          level.count == 0 ? slot.g : max(level.topG, size_t(slot.g));
+        ++level.count;
+        best = onlyInfinite ? slot.f - base : min(best, slot.f - base);
+    }
+
+    void pop()
+    {
+        if (!empty()) {
+            remove(top());
+        }
+    }
+
+    void remove(const Item& item)
+    {
+        if (!contains(item)) {
+            return;
+        }
+
+        BucketSlot slot = item->bucketSlot();
+
+        if (slot.f == INFINITE) {
+            eraseFrom(infinite, slot.index);
+        } else {
+            auto& level = levels[slot.f - base];
+            eraseFrom(level.byG[slot.g], slot.index);
+            --level.count;
+            while (level.count > 0 && level.byG[level.topG].empty()) {
+                --level.topG;
+            }
+            while (best < levels.size() && levels[best].count == 0) {
+                ++best;
+            }
+        }
+
+        items.back()->bucketSlot().item = slot.item;
+        items[slot.item]                = items.back();
+        items.pop_back();
+    }
+
+    // file the node again after its f or g changed
+    void update(const Item& item)
+    {
+        if (contains(item)) {
+            remove(item);
+            push(item);
+        }
+    }
+
+    void clear()
+    {
+        levels.clear();
+        infinite.clear();
+        items.clear();
+        base = 0;
+        best = 0;
+    }
+
+    typename vector<Item>::iterator begin() { return items.begin(); }
+    typename vector<Item>::iterator end() { return items.end(); }
+    typename vector<Item>::const_iterator begin() const
+    {
+        return items.begin();
+    }
+    typename vector<Item>::const_iterator end() const { return items.end(); }
+
+    typename vector<Item>::iterator find(const Item& item)
+    {
+        if (!contains(item)) {
+            return items.end();
+        }
+        return items.begin() +
+               static_cast<long int>(item->bucketSlot().item);
+    }
+
+    bool contains(const Item& item) const
+    {
+        size_t i = item->bucketSlot().item;
+        return i < items.size() && items[i] == item;
+    }
+
+private:
+
+    FBucket& levelOf(size_t f)
+    {
+        if (levels.empty()) {
+            base = f;
+            best = 0;
+        } else if (f < base) {
+            // f-values below the first one seen (inconsistent heuristics)
+            levels.insert(levels.begin(), base - f, FBucket());
+            best += base - f;
+            base = f;
+        }
+
+        if (f - base >= levels.size()) {
+            levels.resize(f - base + 1);
+        }
+        return levels[f - base];
+    }
+
+    // swap the last item into position i
+    static void eraseFrom(vector<Item>& bucket, size_t i)
+    {
+        bucket.back()->bucketSlot().index = static_cast<uint32_t>(i);
+        bucket[i]                         = bucket.back();
+        bucket.pop_back();
+    }
+
+    // levels[f - base]; best is the lowest non-empty one, levels.size() if
+    // only infinite nodes are left
+    vector<FBucket> levels;
+    vector<Item>    infinite;
+    vector<Item>    items;
+    size_t          base;
+    size_t          best;
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+using namespace std;
+
+// What the search needs to know about a domain's Cost type. Domains whose
+// edge costs and heuristics are whole numbers (Domain::hasIntegralCosts)
+// may use a 32-bit integer Cost: g, h and f then compare exactly and take
+// half the room in a node. Integers have no infinity, so the largest value
+// stands in for it (a dead end's learned h) and sums saturate there.
+//
+// Values the meta-reasoning derives from costs (h-hat, f-hat, expected
+// costs) are doubles whatever the Cost; toDouble maps the stand-in back to
+// a real infinity.
+template<class Cost, bool integral = is_integral<Cost>::value>
+struct CostTraits
+{
+    static constexpr Cost infinity()
+    {
+        return numeric_limits<Cost>::infinity();
+    }
+
+    static bool isInfinite(Cost c) { return std::isinf(c); }
+
+    static Cost sum(Cost a, Cost b) { return a + b; }
+
+    static double toDouble(Cost c) { return static_cast<double>(c); }
+};
+
+template<class Cost>
+struct CostTraits<Cost, true>
+{
+    static constexpr Cost infinity() { return numeric_limits<Cost>::max(); }
+
+    static bool isInfinite(Cost c) { return c == infinity(); }
+
+    static Cost sum(Cost a, Cost b)
+    {
+        if (isInfinite(a) || isInfinite(b) || a > infinity() - b) {
+            return infinity();
+        }
+        return static_cast<Cost>(a + b);
+    }
+
+    static double toDouble(Cost c)
+    {
+        return isInfinite(c) ? numeric_limits<double>::infinity()
+                             : static_cast<double>(c);
+    }
+};
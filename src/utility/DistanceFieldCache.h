@@ -0,0 +1,142 @@
+#pragma once
+#include "MappedFile.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Persistent cache of per-cell goal-distance fields (e.g. the racetrack
+// dijkstra map), shared by every run on the same map.
+//
+// A field is identified by the map content hash, the goal and the kind of
+// distance. The first run that needs a field computes it and publishes it with
+// an atomic rename, later runs and concurrent batch workers mmap the published
+// file read-only. Two workers racing on the same missing field both compute
+// it, one of the identical files wins the rename.
+//
+// Caching is off until a directory is set, either with setDirectory() or the
+// METAREASON_CACHE_DIR environment variable.
+class DistanceFieldCache
+{
+public:
+    static void setDirectory(const string& dir) { directory() = dir; }
+
+    static bool enabled() { return !directory().empty(); }
+
+    // Returns the cached field, computing and storing it first if needed.
+    // `compute` fills a vector of `cells` values. The returned mapping stays
+    // valid as long as the shared pointer is held, field data starts at
+    // dataOffset().
+    static shared_ptr<const MappedFile> get(
+      uint64_t mapHash, const string& key, size_t cells,
+      const function<void(vector<double>&)>& compute)
+    {
+        string path = fieldPath(mapHash, key);
+
+        auto f = openField(path, cells);
+        if (f) {
+            return f;
+        }
+
+        vector<double> field(cells, 0);
+        compute(field);
+
+        if (!publish(path, field)) {
+            cerr << "can not write distance cache: " << path << "\n";
+            return nullptr;
+        }
+
+        return openField(path, cells);
+    }
+
+    static size_t dataOffset() { return sizeof(Header); }
+
+private:
+    struct Header
+    {
+        char     magic[8];
+        uint64_t version;
+        uint64_t cells;
+        uint64_t reserved;
+    };
+
+    enum : uint64_t
+    {
+        VERSION = 1
+    };
+
+    // eight bytes including the terminating zero
+    static const char* magic() { return "MRRTDST"; }
+
+    static string& directory()
+    {
+        static string dir = getenv("METAREASON_CACHE_DIR") == nullptr
+                              ? ""
+                              : getenv("METAREASON_CACHE_DIR");
+        return dir;
+    }
+
+    static string fieldPath(uint64_t mapHash, const string& key)
+    {
+        stringstream ss;
+        ss << directory() << "/" << hex << mapHash << "-" << key << ".dist";
+        return ss.str();
+    }
+
+    static shared_ptr<const MappedFile> openField(const string& path,
+                                                  size_t        cells)
+    {
+        auto f = make_shared<MappedFile>();
+        if (!f->open(path) ||
+            f->size() != sizeof(Header) + cells * sizeof(double)) {
+            return nullptr;
+        }
+
+        Header header;
+        memcpy(&header, f->data(), sizeof(header));
+        if (memcmp(header.magic, magic(), sizeof(header.magic)) != 0 ||
+            header.version != VERSION || header.cells != cells) {
+            return nullptr;
+        }
+
+        return f;
+    }
+
+    static bool publish(const string& path, const vector<double>& field)
+    {
+        mkdir(directory().c_str(), 0755);
+
+        string tmpPath = path + ".tmp" + to_string(getpid());
+
+        Header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, magic(), sizeof(header.magic));
+        header.version = VERSION;
+        header.cells   = field.size();
+
+        ofstream out(tmpPath, ios::binary);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(field.data()),
+                  static_cast<streamsize>(field.size() * sizeof(double)));
+        out.close();
+
+        if (!out.good() || rename(tmpPath.c_str(), path.c_str()) != 0) {
+            remove(tmpPath.c_str());
+            return false;
+        }
+
+        return true;
+    }
+};
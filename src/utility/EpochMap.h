@@ -0,0 +1,234 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Hash map for tables the search empties every iteration (closed lists, the
+// heap's item index). The entries live in one dense vector, so iterating
+// visits only live entries; the hash table over them is open addressing
+// whose cells carry the epoch they were written in. clear() destroys the
+// entries and starts a new epoch, which turns every cell stale at once:
+// the table keeps its capacity and is never swept.
+//
+// Same interface as the parts of unordered_map the search uses, except
+// that erasing moves the last entry into the erased one's place, so it
+// invalidates iterators to that last entry.
+template<class Key, class Value, class Hash = hash<Key>>
+class EpochMap
+{
+    struct Cell
+    {
+        uint32_t epoch;
+        uint32_t entry;
+    };
+
+public:
+    typedef pair<Key, Value>                             value_type;
+    typedef typename vector<value_type>::iterator       iterator;
+    typedef typename vector<value_type>::const_iterator const_iterator;
+
+    EpochMap()
+        : epoch(1)
+        , shift(64)
+    {}
+
+    // a compact copy: only the live entries are rehashed
+    EpochMap(const EpochMap& other)
+        : entries(other.entries)
+        , epoch(1)
+        , shift(64)
+    {
+        rehashFor(entries.size());
+    }
+
+    EpochMap& operator=(const EpochMap& other)
+    {
+        if (this != &other) {
+            entries = other.entries;
+            cellOf.clear();
+            rehashFor(entries.size());
+        }
+        return *this;
+    }
+
+    EpochMap(EpochMap&&) = default;
+    EpochMap& operator=(EpochMap&&) = default;
+
+    bool empty() const { return entries.empty(); }
+
+    size_t size() const { return entries.size(); }
+
+    iterator       begin() { return entries.begin(); }
+    iterator       end() { return entries.end(); }
+    const_iterator begin() const { return entries.begin(); }
+    const_iterator end() const { return entries.end(); }
+
+    iterator find(const Key& key)
+    {
+        size_t cell = locate(key);
+        return cell == NONE ? entries.end()
+                            : entries.begin() + static_cast<long int>(
+                                                  cells[cell].entry);
+    }
+
+    const_iterator find(const Key& key) const
+    {
+        size_t cell = locate(key);
+        return cell == NONE ? entries.end()
+                            : entries.begin() + static_cast<long int>(
+                                                  cells[cell].entry);
+    }
+
+    size_t count(const Key& key) const { return locate(key) == NONE ? 0 : 1; }
+
+    Value& operator[](const Key& key)
+    {
+        size_t cell = locate(key);
+        if (cell != NONE) {
+            return entries[cells[cell].entry].second;
+        }
+
+        if ((entries.size() + 1) * 2 > cells.size()) {
+            rehashFor(entries.size() + 1);
+        }
+        entries.emplace_back(key, Value());
+        cellOf.push_back(insertCell(key, entries.size() - 1));
+        return entries.back().second;
+    }
+
+    const Value& at(const Key& key) const
+    {
+        size_t cell = locate(key);
+        if (cell == NONE) {
+            throw out_of_range("EpochMap::at");
+        }
+        return entries[cells[cell].entry].second;
+    }
+
+    size_t erase(const Key& key)
+    {
+        size_t cell = locate(key);
+        if (cell == NONE) {
+            return 0;
+        }
+
+        size_t entry = cells[cell].entry;
+        if (entry + 1 != entries.size()) {
+            entries[entry]             = std::move(entries.back());
+            cellOf[entry]              = cellOf.back();
+            cells[cellOf[entry]].entry = static_cast<uint32_t>(entry);
+        }
+        entries.pop_back();
+        cellOf.pop_back();
+
+        removeCell(cell);
+        return 1;
+    }
+
+    void clear()
+    {
+        entries.clear();
+        cellOf.clear();
+        if (++epoch == 0) {
+            // wrapped around: the one time the cells are swept
+            for (auto& cell : cells) {
+                cell.epoch = 0;
+            }
+            epoch = 1;
+        }
+    }
+
+private:
+    static constexpr size_t NONE = static_cast<size_t>(-1);
+
+    // Fibonacci hashing, so hashes that differ only in their high bits
+    // (pointers, packed coordinates) still spread over the table
+    size_t home(const Key& key) const
+    {
+        return static_cast<size_t>(
+          (static_cast<uint64_t>(hasher(key)) * 0x9E3779B97F4A7C15ull) >>
+          shift);
+    }
+
+    bool live(size_t cell) const { return cells[cell].epoch == epoch; }
+
+    size_t locate(const Key& key) const
+    {
+        if (cells.empty()) {
+            return NONE;
+        }
+
+        size_t mask = cells.size() - 1;
+        for (size_t cell = home(key); live(cell); cell = (cell + 1) & mask) {
+            if (entries[cells[cell].entry].first == key) {
+                return cell;
+            }
+        }
+        return NONE;
+    }
+
+    size_t insertCell(const Key& key, size_t entry)
+    {
+        size_t mask = cells.size() - 1;
+        size_t cell = home(key);
+        while (live(cell)) {
+            cell = (cell + 1) & mask;
+        }
+        cells[cell] = Cell{epoch, static_cast<uint32_t>(entry)};
+        return cell;
+    }
+
+    // backward-shift deletion, which keeps probe chains free of tombstones
+    void removeCell(size_t hole)
+    {
+        size_t mask = cells.size() - 1;
+        for (size_t cell = (hole + 1) & mask; live(cell);
+             cell = (cell + 1) & mask) {
+            size_t want = home(entries[cells[cell].entry].first);
+            // leave the cell if its home lies cyclically in (hole, cell]
+            if (((cell - want) & mask) < ((cell - hole) & mask)) {
+                continue;
+            }
+            cells[hole]               = cells[cell];
+            cellOf[cells[hole].entry] = hole;
+            hole                      = cell;
+        }
+        cells[hole].epoch = epoch - 1;
+    }
+
+    // at most half full for `n` entries
+    void rehashFor(size_t n)
+    {
+        size_t capacity = cells.empty() ? 16 : cells.size();
+        while (capacity < 2 * n) {
+            capacity *= 2;
+        }
+
+        unsigned int bits = 0;
+        while ((size_t(1) << bits) < capacity) {
+            ++bits;
+        }
+        shift = 64 - bits;
+
+        cells.assign(capacity, Cell{0, 0});
+        epoch = 1;
+        cellOf.clear();
+        for (size_t i = 0; i < entries.size(); ++i) {
+            cellOf.push_back(insertCell(entries[i].first, i));
+        }
+    }
+
+    vector<value_type> entries;
+    // the cell pointing at each entry, to fix it when the entry moves
+    vector<size_t> cellOf;
+    vector<Cell>   cells;
+    uint32_t       epoch;
+    // 64 minus log2 of the table size
+    unsigned int shift;
+    Hash         hasher;
+};
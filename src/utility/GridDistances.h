@@ -0,0 +1,104 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// Distances from a batch of grid cells, given as x and y coordinate arrays,
+// to one goal cell, for the grid domains to evaluate all the children of an
+// expansion at once. Built with AVX2 (-mavx2, the ENABLE_AVX2 CMake option)
+// four cells go through each step; otherwise, and for the cells left over,
+// one at a time. Both give the same doubles as the one-state heuristics:
+// the coordinates are integers, so the squares and sums are exact and the
+// square root is correctly rounded either way.
+struct GridDistances
+{
+    static void euclidean(const int32_t* xs, const int32_t* ys, size_t n,
+                          int32_t goalX, int32_t goalY, double* out)
+    {
+        size_t i = 0;
+#ifdef __AVX2__
+        const __m256d gx = _mm256_set1_pd(goalX);
+        const __m256d gy = _mm256_set1_pd(goalY);
+        for (; i + 4 <= n; i += 4) {
+            __m256d dx = _mm256_sub_pd(load(xs + i), gx);
+            __m256d dy = _mm256_sub_pd(load(ys + i), gy);
+            _mm256_storeu_pd(out + i,
+                             _mm256_sqrt_pd(_mm256_add_pd(
+                               _mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy))));
+        }
+#endif
+        for (; i < n; ++i) {
+            double dx = xs[i] - goalX;
+            double dy = ys[i] - goalY;
+            out[i]    = sqrt(dx * dx + dy * dy);
+        }
+    }
+
+    static void manhattan(const int32_t* xs, const int32_t* ys, size_t n,
+                          int32_t goalX, int32_t goalY, double* out)
+    {
+        size_t i = 0;
+#ifdef __AVX2__
+        const __m256d gx   = _mm256_set1_pd(goalX);
+        const __m256d gy   = _mm256_set1_pd(goalY);
+        const __m256d sign = _mm256_set1_pd(-0.0);
+        for (; i + 4 <= n; i += 4) {
+            __m256d dx =
+              _mm256_andnot_pd(sign, _mm256_sub_pd(load(xs + i), gx));
+            __m256d dy =
+              _mm256_andnot_pd(sign, _mm256_sub_pd(load(ys + i), gy));
+            _mm256_storeu_pd(out + i, _mm256_add_pd(dx, dy));
+        }
+#endif
+        for (; i < n; ++i) {
+            out[i] =
+              static_cast<double>(abs(xs[i] - goalX) + abs(ys[i] - goalY));
+        }
+    }
+
+    // the values of a per-cell layer (see GridMap) at the cells, a row
+    // `width` cells long; the cells are indexed in 32 bits, so the map has
+    // fewer than 2^31 of them (the layer alone would take 16 GiB)
+    static void gather(const double* layer, size_t width, const int32_t* xs,
+                       const int32_t* ys, size_t n, double* out)
+    {
+        size_t i = 0;
+#ifdef __AVX2__
+        const __m128i w = _mm_set1_epi32(static_cast<int32_t>(width));
+        // every lane, into zeros (the unmasked gather trips
+        // -Wmaybe-uninitialized in GCC's header)
+        const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+        for (; i + 4 <= n; i += 4) {
+            __m128i cell = _mm_add_epi32(
+              _mm_mullo_epi32(loadInts(ys + i), w), loadInts(xs + i));
+            _mm256_storeu_pd(out + i,
+                             _mm256_mask_i32gather_pd(_mm256_setzero_pd(),
+                                                      layer, cell, all, 8));
+        }
+#endif
+        for (; i < n; ++i) {
+            out[i] = layer[static_cast<size_t>(ys[i]) * width +
+                           static_cast<size_t>(xs[i])];
+        }
+    }
+
+private:
+#ifdef __AVX2__
+    static __m128i loadInts(const int32_t* p)
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    }
+
+    static __m256d load(const int32_t* p)
+    {
+        return _mm256_cvtepi32_pd(loadInts(p));
+    }
+#endif
+};
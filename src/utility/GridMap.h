@@ -0,0 +1,363 @@
+#pragma once
+#include "MappedFile.h"
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Cell layout shared by the grid pathfinding and racetrack domains.
+//
+// A map is either built cell by cell while parsing a text instance, or opened
+// from the binary format written by `write()` (see tools/mapConverter.cpp).
+// The binary file is memory mapped and read in place, so opening a map costs
+// the same no matter how large it is.
+//
+// Binary layout: a fixed size header followed by 64-byte aligned sections.
+// Bitmaps hold one bit per cell in row-major order (index y * width + x),
+// distance layers hold one double per cell in the same order.
+class GridMap
+{
+public:
+    using Location = pair<size_t, size_t>;
+
+    enum Bitmap
+    {
+        BLOCKED = 0,
+        TARPIT,
+        GOAL,
+        BITMAP_COUNT
+    };
+
+    // DIJKSTRA is the exact goal distance of a cell (racetrack dijkstra map,
+    // true distance for the grid domains)
+    enum Layer
+    {
+        DIJKSTRA = 0,
+        EUCLIDEAN,
+        LAYER_COUNT
+    };
+
+    GridMap() { resize(0, 0); }
+
+    GridMap(const GridMap& rhs) { *this = rhs; }
+
+    GridMap& operator=(const GridMap& rhs)
+    {
+        if (&rhs == this) {
+            return *this;
+        }
+
+        width      = rhs.width;
+        height     = rhs.height;
+        start      = rhs.start;
+        goal       = rhs.goal;
+        tarPitCost = rhs.tarPitCost;
+        file       = rhs.file;
+
+        for (size_t i = 0; i < BITMAP_COUNT; ++i) {
+            ownedBits[i] = rhs.ownedBits[i];
+            bitCount[i]  = rhs.bitCount[i];
+            bits[i]      = rhs.isMapped() ? rhs.bits[i] : ownedBits[i].data();
+        }
+
+        for (size_t i = 0; i < LAYER_COUNT; ++i) {
+            ownedLayers[i] = rhs.ownedLayers[i];
+            layerFiles[i]  = rhs.layerFiles[i];
+            if (rhs.isMapped() || layerFiles[i]) {
+                layers[i] = rhs.layers[i];
+            } else {
+                layers[i] =
+                  ownedLayers[i].empty() ? nullptr : ownedLayers[i].data();
+            }
+        }
+
+        return *this;
+    }
+
+    void resize(size_t width_, size_t height_)
+    {
+        file.reset();
+        width  = width_;
+        height = height_;
+
+        for (size_t i = 0; i < BITMAP_COUNT; ++i) {
+            ownedBits[i].assign(wordCount(), 0);
+            bits[i]     = ownedBits[i].data();
+            bitCount[i] = 0;
+        }
+
+        for (size_t i = 0; i < LAYER_COUNT; ++i) {
+            ownedLayers[i].clear();
+            layerFiles[i].reset();
+            layers[i] = nullptr;
+        }
+
+        start      = Location(0, 0);
+        goal       = Location(0, 0);
+        tarPitCost = 1;
+    }
+
+    size_t getWidth() const { return width; }
+    size_t getHeight() const { return height; }
+
+    bool test(Bitmap b, size_t x, size_t y) const
+    {
+        size_t i = index(x, y);
+        return (bits[b][i >> 6] >> (i & 63)) & 1;
+    }
+
+    void set(Bitmap b, size_t x, size_t y)
+    {
+        size_t i = index(x, y);
+        if (!test(b, x, y)) {
+            ownedBits[b][i >> 6] |= uint64_t(1) << (i & 63);
+            ++bitCount[b];
+        }
+    }
+
+    bool isBlocked(size_t x, size_t y) const { return test(BLOCKED, x, y); }
+    bool isTarPit(size_t x, size_t y) const { return test(TARPIT, x, y); }
+    bool isGoal(size_t x, size_t y) const { return test(GOAL, x, y); }
+
+    size_t count(Bitmap b) const { return bitCount[b]; }
+
+    // all cells of a bitmap, e.g. every finish line cell of a racetrack
+    vector<Location> cells(Bitmap b) const
+    {
+        vector<Location> ret;
+        for (size_t w = 0; w < wordCount(); ++w) {
+            uint64_t word = bits[b][w];
+            while (word != 0) {
+                auto   bit = static_cast<size_t>(__builtin_ctzll(word));
+                size_t i   = (w << 6) + bit;
+                ret.push_back(Location(i % width, i / width));
+                word &= word - 1;
+            }
+        }
+        return ret;
+    }
+
+    bool hasLayer(Layer l) const { return layers[l] != nullptr; }
+
+    double layer(Layer l, size_t x, size_t y) const
+    {
+        return layers[l][index(x, y)];
+    }
+
+    // the whole layer, row by row
+    const double* layerData(Layer l) const { return layers[l]; }
+
+    // Allocate (or reset) a per-cell distance layer filled with `fill`.
+    void initLayer(Layer l, double fill)
+    {
+        layerFiles[l].reset();
+        ownedLayers[l].assign(width * height, fill);
+        layers[l] = ownedLayers[l].data();
+    }
+
+    void setLayer(Layer l, size_t x, size_t y, double value)
+    {
+        ownedLayers[l][index(x, y)] = value;
+    }
+
+    void assignLayer(Layer l, vector<double>&& values)
+    {
+        layerFiles[l].reset();
+        ownedLayers[l] = std::move(values);
+        layers[l]      = ownedLayers[l].data();
+    }
+
+    // Use a layer that lives in another mapped file (see DistanceFieldCache),
+    // the cells start `offset` bytes into the file.
+    void attachLayer(Layer l, shared_ptr<const MappedFile> f, size_t offset)
+    {
+        ownedLayers[l].clear();
+        layerFiles[l] = f;
+        layers[l]     = reinterpret_cast<const double*>(f->data() + offset);
+    }
+
+    Location getStart() const { return start; }
+    Location getGoal() const { return goal; }
+    double   getTarPitCost() const { return tarPitCost; }
+
+    void setStart(Location l) { start = l; }
+    void setGoal(Location l) { goal = l; }
+    void setTarPitCost(double c) { tarPitCost = c; }
+
+    bool isMapped() const { return file != nullptr; }
+
+    // Bytes that make up the map itself (dimensions and bitmaps), used to
+    // identify a map independently of the file it came from.
+    uint64_t contentHash() const
+    {
+        // FNV-1a
+        uint64_t h = 0xCBF29CE484222325;
+        auto     mix = [&h](uint64_t v) {
+            for (int i = 0; i < 8; ++i) {
+                h ^= (v >> (i * 8)) & 0xFF;
+                h *= 0x100000001B3;
+            }
+        };
+        mix(width);
+        mix(height);
+        for (size_t b = 0; b < BITMAP_COUNT; ++b) {
+            for (size_t w = 0; w < wordCount(); ++w) {
+                mix(bits[b][w]);
+            }
+        }
+        return h;
+    }
+
+    void write(ostream& out) const
+    {
+        Header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, magic(), sizeof(header.magic));
+        header.version    = VERSION;
+        header.width      = width;
+        header.height     = height;
+        header.startX     = start.first;
+        header.startY     = start.second;
+        header.goalX      = goal.first;
+        header.goalY      = goal.second;
+        header.tarPitCost = tarPitCost;
+
+        uint64_t offset = align(sizeof(Header));
+        for (size_t i = 0; i < BITMAP_COUNT; ++i) {
+            header.bitCount[i]     = bitCount[i];
+            header.bitmapOffset[i] = offset;
+            offset = align(offset + wordCount() * sizeof(uint64_t));
+        }
+        for (size_t i = 0; i < LAYER_COUNT; ++i) {
+            if (!hasLayer(static_cast<Layer>(i))) {
+                continue;
+            }
+            header.layerOffset[i] = offset;
+            offset = align(offset + width * height * sizeof(double));
+        }
+        header.fileSize = offset;
+
+        uint64_t written = 0;
+        auto     put     = [&](const void* p, uint64_t n, uint64_t at) {
+            static const char zeros[ALIGNMENT] = {};
+            while (written < at) {
+                uint64_t pad = min<uint64_t>(at - written, uint64_t(ALIGNMENT));
+                out.write(zeros, static_cast<streamsize>(pad));
+                written += pad;
+            }
+            out.write(static_cast<const char*>(p), static_cast<streamsize>(n));
+            written += n;
+        };
+
+        put(&header, sizeof(header), 0);
+        for (size_t i = 0; i < BITMAP_COUNT; ++i) {
+            put(bits[i], wordCount() * sizeof(uint64_t),
+                header.bitmapOffset[i]);
+        }
+        for (size_t i = 0; i < LAYER_COUNT; ++i) {
+            if (header.layerOffset[i] != 0) {
+                put(layers[i], width * height * sizeof(double),
+                    header.layerOffset[i]);
+            }
+        }
+        put(nullptr, 0, header.fileSize);
+    }
+
+    // Map a binary map file, returns false if it can't be opened or isn't a
+    // map written by this version.
+    bool open(const string& path)
+    {
+        auto f = make_shared<MappedFile>();
+        if (!f->open(path) || f->size() < sizeof(Header)) {
+            return false;
+        }
+
+        Header header;
+        memcpy(&header, f->data(), sizeof(header));
+        if (memcmp(header.magic, magic(), sizeof(header.magic)) != 0 ||
+            header.version != VERSION || header.fileSize != f->size()) {
+            return false;
+        }
+
+        resize(0, 0);
+        width      = header.width;
+        height     = header.height;
+        start      = Location(header.startX, header.startY);
+        goal       = Location(header.goalX, header.goalY);
+        tarPitCost = header.tarPitCost;
+
+        for (size_t i = 0; i < BITMAP_COUNT; ++i) {
+            ownedBits[i].clear();
+            bitCount[i] = header.bitCount[i];
+            bits[i]     = reinterpret_cast<const uint64_t*>(
+              f->data() + header.bitmapOffset[i]);
+        }
+        for (size_t i = 0; i < LAYER_COUNT; ++i) {
+            layers[i] = header.layerOffset[i] == 0
+                          ? nullptr
+                          : reinterpret_cast<const double*>(
+                              f->data() + header.layerOffset[i]);
+        }
+
+        file = f;
+        return true;
+    }
+
+private:
+    struct Header
+    {
+        char     magic[8];
+        uint64_t version;
+        uint64_t width;
+        uint64_t height;
+        uint64_t startX;
+        uint64_t startY;
+        uint64_t goalX;
+        uint64_t goalY;
+        double   tarPitCost;
+        uint64_t bitCount[BITMAP_COUNT];
+        uint64_t bitmapOffset[BITMAP_COUNT];
+        uint64_t layerOffset[LAYER_COUNT];
+        uint64_t fileSize;
+    };
+
+    enum : uint64_t
+    {
+        VERSION   = 1,
+        ALIGNMENT = 64
+    };
+
+    // eight bytes including the terminating zero
+    static const char* magic() { return "MRRTMAP"; }
+
+    static uint64_t align(uint64_t n)
+    {
+        return (n + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+    size_t index(size_t x, size_t y) const { return y * width + x; }
+
+    size_t wordCount() const { return (width * height + 63) / 64; }
+
+    size_t   width;
+    size_t   height;
+    Location start;
+    Location goal;
+    double   tarPitCost;
+
+    vector<uint64_t> ownedBits[BITMAP_COUNT];
+    const uint64_t*  bits[BITMAP_COUNT];
+    size_t           bitCount[BITMAP_COUNT];
+
+    vector<double>               ownedLayers[LAYER_COUNT];
+    const double*                layers[LAYER_COUNT];
+    shared_ptr<const MappedFile> layerFiles[LAYER_COUNT];
+
+    shared_ptr<const MappedFile> file;
+};
@@ -1,7 +1,6 @@
 #pragma once
+#include "Random.h"
 #include <vector>
-#include <cstdlib>
-#include <ctime>
 
 using namespace std;
 // TODO: This hashtable doesn't really work. Tabulation hashing results in non-deterministic search behavior. Very odd.
@@ -123,11 +122,11 @@ class HashTable
 				buckets[i] = NULL;
 			}
 
-			srand(time(NULL));
+			RandomGenerator rng;
 
 			for (int i = 0; i < 256; i++)
 			{
-				randomTable.push_back(rand());
+				randomTable.push_back(static_cast<int>(rng.next() >> 33));
 			}
 		}
 
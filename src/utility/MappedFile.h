@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Read-only memory mapping of a whole file. The mapping is shared with every
+// other process that maps the same file, so concurrent solver runs on the
+// same map only pay for one copy in the page cache.
+class MappedFile
+{
+public:
+    MappedFile()
+        : addr(nullptr)
+        , length(0)
+    {}
+
+    ~MappedFile() { unmap(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const string& path)
+    {
+        unmap();
+
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+            ::close(fd);
+            return false;
+        }
+
+        void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                       MAP_SHARED, fd, 0);
+        // the mapping keeps its own reference to the file
+        ::close(fd);
+
+        if (p == MAP_FAILED) {
+            return false;
+        }
+
+        addr   = p;
+        length = static_cast<size_t>(st.st_size);
+        return true;
+    }
+
+    const char* data() const { return static_cast<const char*>(addr); }
+
+    size_t size() const { return length; }
+
+    bool isOpen() const { return addr != nullptr; }
+
+private:
+    void unmap()
+    {
+        if (addr != nullptr) {
+            munmap(addr, length);
+        }
+        addr   = nullptr;
+        length = 0;
+    }
+
+    void*  addr;
+    size_t length;
+};
@@ -1,8 +1,9 @@
 #pragma once
+#include "EpochMap.h"
+#include <cmath>
 #include <functional>
 #include <iostream>
 #include <limits>
-#include <unordered_map>
 #include <vector>
 
 using namespace std;
@@ -11,12 +12,12 @@ template<class T>
 class PriorityQueue
 {
 protected:
-    vector<T>                 c;
-    unordered_map<T, size_t>  item2index;
-    std::function<bool(T, T)> comp;
-    double                    capacity;
+    vector<T>                               c;
+    EpochMap<T, size_t>                     item2index;
+    std::function<bool(const T&, const T&)> comp;
+    double                                  capacity;
 
-    static bool lessThan(const T n1, const T n2) { return n1 < n2; }
+    static bool lessThan(const T& n1, const T& n2) { return n1 < n2; }
 
 public:
     PriorityQueue()
@@ -27,14 +28,14 @@ public:
     }
 
     PriorityQueue(double                                       maxCapacity,
-                  const std::function<bool(const T, const T)>& comp_)
-        : capacity(maxCapacity)
-        , comp(comp_)
+                  const std::function<bool(const T&, const T&)>& comp_)
+        : comp(comp_)
+        , capacity(maxCapacity)
     {
         makeHeap();
     }
 
-    PriorityQueue(const std::function<bool(const T, const T)>& comp_)
+    PriorityQueue(const std::function<bool(const T&, const T&)>& comp_)
         : comp(comp_)
     {
         capacity = numeric_limits<double>::infinity();
@@ -67,23 +68,27 @@ public:
         return *this;
     }
 
-    void swapComparator(const std::function<bool(const T, const T)>& comp_)
+    void swapComparator(const std::function<bool(const T&, const T&)>& comp_)
     {
         comp = comp_;
         makeHeap();
     }
 
+    // put a bounded queue in min-max order, an unbounded one back in heap
+    // order
+    void setCapacity(double maxCapacity)
+    {
+        capacity = maxCapacity;
+        makeHeap();
+    }
+
     void update(T item)
     {
         if (item2index.find(item) == item2index.end()) {
             return;
         }
 
-        auto itemIndex = item2index[item];
-        if (comp(c[itemIndex], c[parent(itemIndex)]))
-            pullUp(itemIndex);
-        else
-            pushDown(itemIndex);
+        restore(item2index[item]);
     }
 
     bool empty() const { return c.empty(); }
@@ -95,38 +100,40 @@ public:
 
     const T top() const { return c.front(); }
 
-    void push(const T item)
-    {
-        // If the size is at maximum capacity, find the worst item in the queue
-        if (static_cast<double>(c.size()) == capacity) {
-            size_t worstIndex = 0;
-            for (size_t i = 1; i < c.size(); i++) {
-                if (comp(c[worstIndex], c[i])) {
-                    worstIndex = i;
-                }
-            }
+    bool contains(const T& item) const { return item2index.count(item) != 0; }
+
+    // the item the queue would give up first when full
+    const T worst() const { return c[worstIndex()]; }
 
-            // Check if the new item is better than the worst...
-            if (comp(item, c[worstIndex])) {
-                // Erase the worst
-                swap2item(worstIndex, last());
+    // At capacity, the worst of the queue and the new item is dropped.
+    // Returns the item dropped (which may be `item` itself), or T() if
+    // there was room.
+    T push(const T item)
+    {
+        T dropped = T();
 
-                item2index.erase(c[last()]);
-                c.erase(c.begin() + static_cast<long int>(last()));
+        if (static_cast<double>(c.size()) >= capacity) {
+            if (c.empty()) {
+                return item;
+            }
 
-                if (comp(c[worstIndex], c[parent(worstIndex)]))
-                    pullUp(worstIndex);
-                else
-                    pushDown(worstIndex);
-            } else {
-                // If it isn't, do not add this item
-                return;
+            size_t w = worstIndex();
+            if (!comp(item, c[w])) {
+                return item;
             }
+
+            dropped = c[w];
+            removeAt(w);
         }
 
         c.push_back(item);
         item2index[item] = c.size() - 1;
-        pullUp(last());
+        if (bounded()) {
+            bubbleUp(last());
+        } else {
+            pullUp(last());
+        }
+        return dropped;
     }
 
     void pop()
@@ -134,12 +141,7 @@ public:
         if (c.empty()) {
             return;
         }
-        swap2item(0, last());
-
-        item2index.erase(c[last()]);
-        c.erase(c.begin() + static_cast<long int>(last()));
-
-        pushDown(0);
+        removeAt(0);
     }
 
     void remove(T item)
@@ -147,29 +149,24 @@ public:
         if (item2index.find(item) == item2index.end()) {
             return;
         }
-
-        auto itemIndex = item2index[item];
-        swap2item(item2index[item], last());
-        item2index.erase(c[last()]);
-        c.erase(c.begin() + static_cast<long int>(last()));
-
-        if (comp(c[itemIndex], c[parent(itemIndex)]))
-            pullUp(itemIndex);
-        else
-            pushDown(itemIndex);
+        removeAt(item2index[item]);
     }
 
+    // keeps the capacity of both the heap and its index
     void clear()
     {
-        while (!c.empty()) {
-            c.pop_back();
-        }
+        c.clear();
+        item2index.clear();
     }
 
     typename vector<T>::iterator begin() { return c.begin(); }
 
     typename vector<T>::iterator end() { return c.end(); }
 
+    typename vector<T>::const_iterator begin() const { return c.begin(); }
+
+    typename vector<T>::const_iterator end() const { return c.end(); }
+
     typename vector<T>::iterator find(T item)
     {
         if (item2index.find(item) == item2index.end()) {
@@ -180,6 +177,12 @@ public:
     }
 
 private:
+    // A bounded queue is kept as a min-max heap: the levels alternate
+    // between holding the best and the worst of their subtrees, so the
+    // worst item is one of the root's children and evicting it costs a
+    // logarithmic sift instead of a scan of the whole queue.
+    bool bounded() const { return !std::isinf(capacity); }
+
     size_t last() { return c.size() - 1; }
 
     size_t parent(size_t i) { return i > 1 ? (i - 1) / 2 : 0; }
@@ -188,6 +191,50 @@ private:
 
     size_t leftChild(size_t i) { return static_cast<size_t>(2 * i + 1); }
 
+    size_t worstIndex() const
+    {
+        if (bounded()) {
+            if (c.size() < 3) {
+                return c.size() - 1;
+            }
+            return comp(c[1], c[2]) ? 2 : 1;
+        }
+
+        size_t w = 0;
+        for (size_t i = 1; i < c.size(); i++) {
+            if (comp(c[w], c[i])) {
+                w = i;
+            }
+        }
+        return w;
+    }
+
+    void removeAt(size_t i)
+    {
+        swap2item(i, last());
+
+        item2index.erase(c[last()]);
+        c.pop_back();
+
+        if (i < c.size()) {
+            restore(i);
+        }
+    }
+
+    // sift the item at i to its place after it changed or was moved there
+    void restore(size_t i)
+    {
+        if (bounded()) {
+            // if the item climbs, what it displaces may still have to sink
+            bubbleUp(i);
+            trickleDown(i);
+        } else if (comp(c[i], c[parent(i)])) {
+            pullUp(i);
+        } else {
+            pushDown(i);
+        }
+    }
+
     void swap2item(size_t a, size_t b)
     {
         item2index[c[a]] = b;
@@ -221,10 +268,89 @@ private:
         }
     }
 
+    // min-max heap: the root's level and every other one below it hold
+    // the best of their subtrees
+    static bool onBestLevel(size_t i)
+    {
+        size_t depth = 0;
+        for (size_t n = i + 1; n > 1; n >>= 1) {
+            ++depth;
+        }
+        return depth % 2 == 0;
+    }
+
+    // whether a belongs above b on a level of kind `best`
+    bool before(size_t a, size_t b, bool best) const
+    {
+        return best ? comp(c[a], c[b]) : comp(c[b], c[a]);
+    }
+
+    void bubbleUp(size_t i)
+    {
+        if (i == 0) {
+            return;
+        }
+
+        bool   best = onBestLevel(i);
+        size_t p    = parent(i);
+        if (before(i, p, !best)) {
+            swap2item(i, p);
+            bubbleUpAlong(p, !best);
+        } else {
+            bubbleUpAlong(i, best);
+        }
+    }
+
+    // climb the grandparents, the levels of the same kind
+    void bubbleUpAlong(size_t i, bool best)
+    {
+        while (i > 2 && before(i, parent(parent(i)), best)) {
+            swap2item(i, parent(parent(i)));
+            i = parent(parent(i));
+        }
+    }
+
+    void trickleDown(size_t i)
+    {
+        bool best = onBestLevel(i);
+
+        while (leftChild(i) < c.size()) {
+            // the best (worst) of the children and grandchildren
+            size_t m     = leftChild(i);
+            size_t first = leftChild(i);
+            for (size_t k = first; k < first + 2 && k < c.size(); ++k) {
+                if (before(k, m, best)) {
+                    m = k;
+                }
+                for (size_t g = leftChild(k); g < leftChild(k) + 2; ++g) {
+                    if (g < c.size() && before(g, m, best)) {
+                        m = g;
+                    }
+                }
+            }
+
+            if (!before(m, i, best)) {
+                return;
+            }
+            swap2item(i, m);
+            if (parent(m) == i) {
+                return;
+            }
+            if (before(parent(m), m, best)) {
+                swap2item(m, parent(m));
+            }
+            i = m;
+        }
+    }
+
     void makeHeap()
     {
         for (int i = (static_cast<int>(c.size()) / 2) - 1; i >= 0; i--) {
-            pushDown(static_cast<size_t>(i));
+            if (bounded()) {
+                trickleDown(static_cast<size_t>(i));
+            } else {
+                pushDown(static_cast<size_t>(i));
+            }
         }
     }
 };
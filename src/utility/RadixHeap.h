@@ -0,0 +1,128 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Priority queue for monotone passes, where no key pushed is lower than the
+// last one popped (the backward Dijkstra passes over a lookahead): entries
+// are filed by the highest bit in which their key differs from the last
+// popped one, so a push is constant time and a pop amortizes to a few scans
+// of the bucket it empties. Keys are doubles, compared through their bit
+// patterns.
+//
+// There is no decrease-key: push the value again under its lower key and
+// skip the stale entry when it comes up (topKey() tells which key an entry
+// was pushed with). A key below the last popped one is treated as equal to
+// it; once empty, the heap takes any key again.
+template<class T>
+class RadixHeap
+{
+    struct Entry
+    {
+        uint64_t bits;
+        double   key;
+        T        value;
+    };
+
+public:
+    RadixHeap()
+        : buckets(65)
+        , last(0)
+        , count(0)
+    {}
+
+    bool empty() const { return count == 0; }
+
+    size_t size() const { return count; }
+
+    void push(double key, const T& value)
+    {
+        uint64_t bits = toBits(key);
+        if (bits < last) {
+            bits = last;
+        }
+        buckets[bucketOf(bits)].push_back(Entry{bits, key, value});
+        ++count;
+    }
+
+    // the value with the lowest key; call only on a non-empty heap
+    const T& top()
+    {
+        refill();
+        return buckets[0].back().value;
+    }
+
+    double topKey()
+    {
+        refill();
+        return buckets[0].back().key;
+    }
+
+    void pop()
+    {
+        refill();
+        buckets[0].pop_back();
+        if (--count == 0) {
+            last = 0;
+        }
+    }
+
+    void clear()
+    {
+        for (auto& bucket : buckets) {
+            bucket.clear();
+        }
+        last  = 0;
+        count = 0;
+    }
+
+private:
+    // order-preserving: negative doubles have every bit flipped, the others
+    // just the sign bit
+    static uint64_t toBits(double key)
+    {
+        uint64_t bits;
+        memcpy(&bits, &key, sizeof bits);
+        return (bits >> 63) != 0 ? ~bits : bits | (uint64_t(1) << 63);
+    }
+
+    size_t bucketOf(uint64_t bits) const
+    {
+        uint64_t diff = bits ^ last;
+        return diff == 0 ? 0 : static_cast<size_t>(64 - __builtin_clzll(diff));
+    }
+
+    // move the entries with the lowest key into bucket 0
+    void refill()
+    {
+        if (!buckets[0].empty()) {
+            return;
+        }
+
+        size_t i = 1;
+        while (buckets[i].empty()) {
+            ++i;
+        }
+
+        last = buckets[i].front().bits;
+        for (const auto& entry : buckets[i]) {
+            if (entry.bits < last) {
+                last = entry.bits;
+            }
+        }
+
+        for (auto& entry : buckets[i]) {
+            buckets[bucketOf(entry.bits)].push_back(std::move(entry));
+        }
+        buckets[i].clear();
+    }
+
+    // buckets[0] holds keys equal to last, buckets[b] those differing from
+    // it first in bit b - 1
+    vector<vector<Entry>> buckets;
+    uint64_t              last;
+    size_t                count;
+};
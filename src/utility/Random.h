@@ -1,33 +1,99 @@
 #pragma once
+#include <cstdint>
 #include <limits>
-#include <cmath>
+#include <utility>
 
 using namespace std;
 
+// xoshiro256** (Blackman and Vigna), the one generator used for everything
+// random in the solver, the benchmarks and the instance generators.
+//
+// A generator constructed without a seed uses the process-wide default seed
+// (set by --seed), so two runs of the same binary with the same seed take the
+// same search path. It is a UniformRandomBitGenerator, but prefer below() and
+// random() over <random> distributions, whose output differs between
+// standard libraries.
 class RandomGenerator
 {
-	long lo;
-	long hi;
-	unsigned long seed;
-	long test;
-	const long a = 48271.0;
-	const long m = 2147483647.0;
-	const long q = m / a;
-	const long r = m % a;
 public:
-	RandomGenerator() : seed(0) {}
-	RandomGenerator(unsigned long seed) : seed(seed) {};
-	unsigned long getSeed() { return seed; }
-	void setSeed(unsigned long s) { seed = s; }
-	double random()
-	{
-		hi = seed / q;
-		lo = seed % q;
-		test = a * lo - r * hi;
-		if (test > 0.0)
-			seed = test;
-		else
-			seed = test + m;
-		return ((double) seed / m);
-	}
-};
\ No newline at end of file
+    typedef uint64_t result_type;
+
+    RandomGenerator() { setSeed(defaultSeed()); }
+
+    explicit RandomGenerator(uint64_t seed_) { setSeed(seed_); }
+
+    static uint64_t& defaultSeed()
+    {
+        static uint64_t seed = 1;
+        return seed;
+    }
+
+    uint64_t getSeed() const { return seed; }
+
+    // expand the seed into the 256 bit state with splitmix64
+    void setSeed(uint64_t seed_)
+    {
+        seed       = seed_;
+        uint64_t x = seed_;
+        for (auto& word : state) {
+            x += 0x9E3779B97F4A7C15;
+            uint64_t z = x;
+            z          = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+            z          = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+            word       = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t next()
+    {
+        uint64_t result = rotl(state[1] * 5, 7) * 9;
+        uint64_t t      = state[1] << 17;
+
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+
+        return result;
+    }
+
+    result_type operator()() { return next(); }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max()
+    {
+        return numeric_limits<result_type>::max();
+    }
+
+    // uniform in [0, 1)
+    double random()
+    {
+        return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    // uniform in [0, n), n > 0
+    uint64_t below(uint64_t n) { return next() % n; }
+
+    // Fisher-Yates, the same permutation on every standard library
+    template<class RandomIt>
+    void shuffle(RandomIt first, RandomIt last)
+    {
+        auto n = last - first;
+        for (auto i = n - 1; i > 0; --i) {
+            auto j =
+              static_cast<decltype(i)>(below(static_cast<uint64_t>(i + 1)));
+            std::swap(first[i], first[j]);
+        }
+    }
+
+private:
+    static uint64_t rotl(uint64_t x, int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    uint64_t seed;
+    uint64_t state[4];
+};
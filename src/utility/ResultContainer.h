@@ -1,14 +1,11 @@
 #pragma once
 #include <iostream>
 #include <queue>
+#include <vector>
 
 using namespace std;
 
 struct ResultContainer {
-    vector<vector<string>> paths;
-    vector<vector<string>> visited;
-    vector<vector<string>> committed;
-    vector<bool> isKeepThinkingFlags;
     bool solutionFound;
     double solutionCost;
     double solutionLength;
@@ -37,10 +34,6 @@ struct ResultContainer {
         nodesGenerated = res.nodesGenerated;
         nodesExpanded = res.nodesExpanded;
         GATnodesExpanded = res.GATnodesExpanded;
-        paths = res.paths;
-        visited = res.visited;
-        committed = res.committed;
-        isKeepThinkingFlags = res.isKeepThinkingFlags;
 		lookaheadCpuTime = res.lookaheadCpuTime;
 		epsilonHGlobal = res.epsilonHGlobal;
 		epsilonDGlobal = res.epsilonDGlobal;
@@ -56,10 +49,6 @@ struct ResultContainer {
             nodesGenerated = rhs.nodesGenerated;
             nodesExpanded = rhs.nodesExpanded;
             GATnodesExpanded = rhs.GATnodesExpanded;
-            paths = rhs.paths;
-            visited = rhs.visited;
-            committed = rhs.committed;
-            isKeepThinkingFlags = rhs.isKeepThinkingFlags;
             lookaheadCpuTime = rhs.lookaheadCpuTime;
             epsilonHGlobal = rhs.epsilonHGlobal;
             epsilonDGlobal = rhs.epsilonDGlobal;
@@ -0,0 +1,102 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Bounded lock-free queue between exactly one producer thread and one
+// consumer thread. Each side owns one index and publishes it with a release
+// store the other side reads with acquire, so an element is written before
+// the consumer sees it and moved out before the producer reuses its slot.
+// Each side also keeps a stale copy of the other's index and only reloads it
+// when the queue looks full (or empty), so the two threads mostly stay off
+// each other's cache lines.
+template<class T>
+class SpscQueue
+{
+public:
+    // holds at least `capacity` elements, rounded up to a power of two
+    explicit SpscQueue(size_t capacity)
+        : slots(roundUp(capacity))
+        , mask(slots.size() - 1)
+    {
+        producer.index  = 0;
+        producer.cached = 0;
+        consumer.index  = 0;
+        consumer.cached = 0;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // producer only; false if the queue is full
+    bool tryPush(const T& item)
+    {
+        size_t tail = producer.index.load(memory_order_relaxed);
+        if (tail - producer.cached > mask) {
+            producer.cached = consumer.index.load(memory_order_acquire);
+            if (tail - producer.cached > mask) {
+                return false;
+            }
+        }
+
+        slots[tail & mask] = item;
+        producer.index.store(tail + 1, memory_order_release);
+        return true;
+    }
+
+    // consumer only; false if the queue is empty
+    bool tryPop(T& item)
+    {
+        size_t head = consumer.index.load(memory_order_relaxed);
+        if (head == consumer.cached) {
+            consumer.cached = producer.index.load(memory_order_acquire);
+            if (head == consumer.cached) {
+                return false;
+            }
+        }
+
+        item = std::move(slots[head & mask]);
+        consumer.index.store(head + 1, memory_order_release);
+        return true;
+    }
+
+    // consumer only
+    bool empty() const
+    {
+        return consumer.index.load(memory_order_relaxed) ==
+               producer.index.load(memory_order_acquire);
+    }
+
+    size_t capacity() const { return slots.size(); }
+
+private:
+    static size_t roundUp(size_t n)
+    {
+        size_t size = 1;
+        while (size < n) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    static constexpr size_t cacheLine = 64;
+
+    // the index one side writes and its copy of the other side's, padded
+    // onto a cache line of their own (C++14 new cannot align to one)
+    struct Side
+    {
+        char           before[cacheLine];
+        atomic<size_t> index;
+        size_t         cached;
+        char           after[cacheLine - sizeof(atomic<size_t>) -
+                   sizeof(size_t)];
+    };
+
+    vector<T>    slots;
+    const size_t mask;
+    Side         producer;
+    Side         consumer;
+};
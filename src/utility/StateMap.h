@@ -0,0 +1,64 @@
+#pragma once
+#include "EpochMap.h"
+#include <cstdint>
+#include <functional>
+
+using namespace std;
+
+// A map from the states of a domain, for the search's closed lists and the
+// domains' learned tables. A State whose key() is perfect, a 64-bit value
+// no other state of the domain shares, declares
+//
+//     static constexpr bool perfectKey = true;
+//
+// and the map then holds that key alone instead of a copy of the State,
+// so the only copy is the one in the node. Other States are keys
+// themselves, hashed with the domain's HashState.
+//
+// Either way lookups take a State; iterating yields (key, value) pairs,
+// so take the state from the value when it is needed.
+template<class State, class Value, class Hash,
+         bool perfect = State::perfectKey>
+class StateMap : public EpochMap<State, Value, Hash>
+{};
+
+template<class State, class Value, class Hash>
+class StateMap<State, Value, Hash, true>
+    : private EpochMap<uint64_t, Value, hash<uint64_t>>
+{
+    typedef EpochMap<uint64_t, Value, hash<uint64_t>> Map;
+
+    static uint64_t keyOf(const State& state)
+    {
+        return static_cast<uint64_t>(state.key());
+    }
+
+public:
+    using typename Map::const_iterator;
+    using typename Map::iterator;
+    using typename Map::value_type;
+
+    using Map::begin;
+    using Map::clear;
+    using Map::empty;
+    using Map::end;
+    using Map::size;
+
+    iterator find(const State& state) { return Map::find(keyOf(state)); }
+
+    const_iterator find(const State& state) const
+    {
+        return Map::find(keyOf(state));
+    }
+
+    size_t count(const State& state) const { return Map::count(keyOf(state)); }
+
+    Value& operator[](const State& state)
+    {
+        return Map::operator[](keyOf(state));
+    }
+
+    const Value& at(const State& state) const { return Map::at(keyOf(state)); }
+
+    size_t erase(const State& state) { return Map::erase(keyOf(state)); }
+};
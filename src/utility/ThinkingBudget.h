@@ -0,0 +1,25 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+
+using namespace std;
+
+// When a step thought about in slices (RealTimeSearch::think) hands control
+// back: at the deadline, or as soon as another thread raises `preempted`.
+// Asked before every expansion.
+struct ThinkingBudget
+{
+    typedef chrono::steady_clock::time_point TimePoint;
+
+    TimePoint           deadline  = TimePoint::max();
+    const atomic<bool>* preempted = nullptr;
+
+    bool operator()() const
+    {
+        if (preempted && preempted->load(memory_order_relaxed)) {
+            return true;
+        }
+        return deadline != TimePoint::max() &&
+               chrono::steady_clock::now() >= deadline;
+    }
+};
@@ -0,0 +1,51 @@
+#pragma once
+#include "TraceSink.h"
+#include <nlohmann/json.hpp>
+
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// Rebuild the visualization json (path, visited, isKeepThinking, committed)
+// from a binary trace written by BinaryTraceSink.
+inline nlohmann::json decodeTrace(istream& in)
+{
+    unordered_map<uint64_t, string> names;
+    vector<vector<string>>          groups[3];
+    vector<bool>                    isKeepThinkingFlags;
+
+    TraceRecord r;
+    while (in.read(reinterpret_cast<char*>(&r), sizeof(r))) {
+        if (r.phase == TracePhase::STATE_NAME) {
+            string name(r.length, '\0');
+            in.read(&name[0], static_cast<streamsize>(r.length));
+            names[r.key] = name;
+            continue;
+        }
+
+        if (r.phase == TracePhase::KEEP_THINKING) {
+            isKeepThinkingFlags.push_back(r.key != 0);
+            continue;
+        }
+
+        auto& g = groups[static_cast<size_t>(r.phase)];
+        if (r.kind == TraceRecord::GROUP || g.empty()) {
+            g.push_back(vector<string>());
+        }
+        if (r.kind == TraceRecord::ITEM) {
+            g.back().push_back(names[r.key]);
+        }
+    }
+
+    nlohmann::json record;
+
+    record["path"] = groups[static_cast<size_t>(TracePhase::PATH)];
+    record["visited"] = groups[static_cast<size_t>(TracePhase::VISITED)];
+    record["isKeepThinking"] = isKeepThinkingFlags;
+    record["committed"] = groups[static_cast<size_t>(TracePhase::COMMITTED)];
+
+    return record;
+}
@@ -0,0 +1,152 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// What a trace record belongs to, one per array of the visualization json.
+enum class TracePhase : uint8_t
+{
+    PATH = 0,
+    VISITED,
+    COMMITTED,
+    KEEP_THINKING,
+    STATE_NAME
+};
+
+// Fixed size record of the binary trace.
+//
+// GROUP opens a new inner array of its phase, ITEM appends to the last one.
+// For KEEP_THINKING items the key is the flag. A STATE_NAME record is followed
+// by `length` bytes of the state's toString(), it is written the first time a
+// key shows up in the trace and again whenever a different state with the same
+// key (a hash collision) shows up, so decoding in order always yields the
+// right name.
+struct TraceRecord
+{
+    enum Kind : uint8_t
+    {
+        GROUP = 0,
+        ITEM
+    };
+
+    uint64_t   key;
+    uint32_t   iteration;
+    TracePhase phase;
+    Kind       kind;
+    uint16_t   reserved;
+    uint32_t   length;
+    uint32_t   reserved2;
+};
+
+// Receives the search trace (paths, visited and committed states) while the
+// run proceeds. Search code holds a TraceSink pointer that is null when
+// tracing is off, so an untraced run only pays for a null check and memory
+// stays flat however long the run is.
+class TraceSink
+{
+public:
+    virtual ~TraceSink() = default;
+
+    void setIteration(size_t it) { iteration = static_cast<uint32_t>(it); }
+
+    void beginGroup(TracePhase phase) { put(phase, TraceRecord::GROUP, 0); }
+
+    template<class State>
+    void state(TracePhase phase, const State& s)
+    {
+        string name = s.toString();
+        auto   it   = names.find(s.key());
+        if (it == names.end() || it->second != name) {
+            nameState(s.key(), name);
+            names[s.key()] = std::move(name);
+        }
+        put(phase, TraceRecord::ITEM, s.key());
+    }
+
+    // a group with a single state
+    template<class State>
+    void singleton(TracePhase phase, const State& s)
+    {
+        beginGroup(phase);
+        state(phase, s);
+    }
+
+    void keepThinking(bool flag)
+    {
+        put(TracePhase::KEEP_THINKING, TraceRecord::ITEM, flag ? 1 : 0);
+    }
+
+protected:
+    virtual void write(const TraceRecord& r, const string* name) = 0;
+
+private:
+    void put(TracePhase phase, TraceRecord::Kind kind, uint64_t key)
+    {
+        TraceRecord r = makeRecord(phase, kind, key);
+        write(r, nullptr);
+    }
+
+    void nameState(uint64_t key, const string& name)
+    {
+        TraceRecord r =
+          makeRecord(TracePhase::STATE_NAME, TraceRecord::ITEM, key);
+        r.length = static_cast<uint32_t>(name.size());
+        write(r, &name);
+    }
+
+    TraceRecord makeRecord(TracePhase phase, TraceRecord::Kind kind,
+                           uint64_t key) const
+    {
+        TraceRecord r;
+        r.key       = key;
+        r.iteration = iteration;
+        r.phase     = phase;
+        r.kind      = kind;
+        r.reserved  = 0;
+        r.length    = 0;
+        r.reserved2 = 0;
+        return r;
+    }
+
+    uint32_t                        iteration = 0;
+    unordered_map<uint64_t, string> names;
+};
+
+// Streams the trace into a binary file, see TraceDecoder.h for reading it
+// back.
+class BinaryTraceSink : public TraceSink
+{
+public:
+    BinaryTraceSink(const string& path)
+        : buffer(1 << 16)
+    {
+        out.rdbuf()->pubsetbuf(buffer.data(),
+                               static_cast<streamsize>(buffer.size()));
+        out.open(path, ios::binary);
+        if (!out.good()) {
+            cerr << "can not write trace file: " << path << "\n";
+            exit(1);
+        }
+    }
+
+    ~BinaryTraceSink() { out.close(); }
+
+protected:
+    void write(const TraceRecord& r, const string* name)
+    {
+        out.write(reinterpret_cast<const char*>(&r), sizeof(r));
+        if (name != nullptr) {
+            out.write(name->data(), static_cast<streamsize>(name->size()));
+        }
+    }
+
+private:
+    vector<char> buffer;
+    ofstream     out;
+};
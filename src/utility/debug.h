@@ -5,10 +5,28 @@
 #define DEBUG_MSG(str) do { } while ( false )
 #endif
 
+// Compile-time trace level, set with -DTRACE_LEVEL=<n> (cmake -DTRACE_LEVEL=<n>).
+// Every trace statement is guarded by a comparison against this constant, so
+// a level below it compiles the statement away.
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL 1
+#endif
+
+enum TraceLevel
+{
+    TRACE_OFF = 0,
+    // paths, visited and committed states to a TraceSink (--visOut, --traceOut)
+    TRACE_SINK,
+    // additionally dump every expanded node to stderr
+    TRACE_EXPANSIONS
+};
+
+constexpr int traceLevel = TRACE_LEVEL;
+
 #include <sstream>
 
 //template <typename T>
-std::string my_to_string(const double a_value, const int n = 2)
+inline std::string my_to_string(const double a_value, const int n = 2)
 {
     std::ostringstream out;
     out.precision(n);